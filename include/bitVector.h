@@ -0,0 +1,44 @@
+#ifndef BIT_VECTOR_H
+#define BIT_VECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// bits packed 64 to a word, bit i is bit i % 64 of word i / 64. the bits past size() in the last
+// word stay zero, so equal vectors have equal words and compare a word at a time. the storage is
+// kept by clear and reset, so a vector reused across trials stops allocating
+class BitVector {
+public:
+  BitVector() : numBits(0) {}
+  explicit BitVector(int numBits) : numBits(numBits), bitWords(wordsFor(numBits), 0) {}
+  static int wordsFor(int numBits) { return (numBits + 63) / 64; }
+
+  int size() const { return numBits; }
+  int numWords() const { return bitWords.size(); }
+  uint64_t* words() { return bitWords.data(); }
+  const uint64_t* words() const { return bitWords.data(); }
+
+  int get(int i) const { return (bitWords[i >> 6] >> (i & 63)) & 1; }
+  void set(int i, int bit) {
+    uint64_t mask = 1ull << (i & 63);
+    bitWords[i >> 6] = bit ? bitWords[i >> 6] | mask : bitWords[i >> 6] & ~mask;
+  }
+
+  void clear() { numBits = 0; bitWords.clear(); }
+  void reset(int numBits);   // numBits zero bits
+  void resize(int numBits);  // keeps the first bits, new ones are zero
+
+  bool operator==(const BitVector& bits) const { return numBits == bits.numBits && bitWords == bits.bitWords; }
+  bool operator!=(const BitVector& bits) const { return !(*this == bits); }
+
+  // one int per bit, for the interfaces that still take them
+  static BitVector fromInts(const std::vector<int>& bits);
+  void toInts(std::vector<int>& bits) const;
+
+private:
+  int numBits;
+  std::vector<uint64_t> bitWords;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef ERROR_EVENT_SAMPLER_H
+#define ERROR_EVENT_SAMPLER_H
+
+#include <vector>
+
+#include "bitVector.h"
+#include "mla_types.h"
+#include "trialRng.h"
+
+// the sampling channel of importance sampling. mistakes come from the low-weight error events of the
+// code, so a trial picks a starting bit uniformly and moves the noise mean of the event starting
+// there toward the other BPSK point. the trial is weighted by p / q, q the mixture over every
+// starting bit, so any trial that lands near one of the events keeps a moderate weight
+class ErrorEventSampler {
+public:
+  // the lowest-weight event of every starting bit of the tail-biting code, over the input patterns
+  // 1 x ... x 1 no longer than maxSpan bits, weighted by the unpunctured symbols they flip
+  ErrorEventSampler(CodeInformation code, const PuncturingPattern& puncturing, int maxSpan, double shift);
+
+  // BPSK of the codeword plus the shifted noise of the trial the rng is on. returns log p/q of the
+  // draw, which weights the trial into an unbiased estimate under the channel
+  double addNoise(const BitVector& codeword, double SNR, TrialRng& rng, std::vector<double>& received) const;
+
+  int minEventWeight() const;
+  int maxEventWeight() const;
+
+private:
+  std::vector<std::vector<int>> events;  // symbols of the event starting at every message bit
+  double shift;                          // of the noise mean, in BPSK amplitudes
+
+  // log q_event / p of the received symbols
+  double eventExponent(size_t event, const BitVector& codeword, const std::vector<double>& received, double variance) const;
+};
+
+#endif
@@ -2,11 +2,16 @@
 #define FEEDFORWARDTRELLIS_H
 #include <vector>
 #include <string>
+#include <cstdint>
+
+#include "bitVector.h"
 
 class FeedForwardTrellis {
 public:
 	FeedForwardTrellis(int k, int n, int v, std::vector<int> numerators);
-	std::vector<int> encode(std::vector<int> originalMessage);
+	std::vector<int> encode(const std::vector<int>& originalMessage);
+	void encode(const BitVector& originalMessage, BitVector& codeword);
+	void encodeBatch(const std::vector<BitVector>& originalMessages, std::vector<BitVector>& codewords);
 	std::vector<std::vector<int>> getNextStates();
 	std::vector<std::vector<int>> getOutputs();
 	int getNumInputSymbols();
@@ -25,7 +30,19 @@ private:
 	std::vector<std::vector<int>> nextStates;
 	std::vector<std::vector<int>> outputs;
 
+	// encoder tables, flat over (state, input): the next state, and the n output bits packed with the
+	// first one least significant
+	std::vector<int> nextStateTable;
+	std::vector<uint64_t> outputBits;
+	int memorySymbols;  // input symbols that fill the v memory elements, ceil(v / k)
+	std::vector<int> batchStates;  // running state of every frame of encodeBatch, only ever grown
+
 	void computeNextStates();
+	void computeEncoderTables();
+	int inputSymbol(const BitVector& message, int symbol) const;
+	int tailBitingState(const BitVector& message) const;
+	void appendOutput(uint64_t* words, int position, int branch) const;
+	void encodeBruteForce(const BitVector& originalMessage, BitVector& codeword);
 
 	std::vector<int> dec2Bin(int decimal, int length);
     int bin2Dec(std::vector<int> binary);
@@ -0,0 +1,57 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <iostream>
+#include <vector>
+
+// bins of one histogram axis, with an underflow bin 0 and an overflow bin numBins + 1. log bins
+// split every octave above min into binsPerOctave geometric bins, for values like list sizes that
+// span several orders of magnitude
+class HistogramAxis {
+public:
+  static HistogramAxis linear(double min, double max, int numBins);
+  static HistogramAxis log2(double min, int octaves, int binsPerOctave);
+
+  int size() const { return numBins + 2; }
+  int bin(double value) const;
+  double lowerEdge(int bin) const;
+  double upperEdge(int bin) const;
+  bool operator==(const HistogramAxis& axis) const;
+
+private:
+  HistogramAxis(bool logarithmic, double min, double max, int numBins, double binsPerUnit);
+  bool logarithmic;
+  double min;
+  double max;
+  int numBins;
+  double binsPerUnit;  // bins per unit of the value, or per octave for log bins
+  double edge(int index) const;
+};
+
+// counts over one or two axes, stored row-major as [x][y]. weighted values add their weight instead
+// of one, so a bin holds the weight sum of its values. histograms over the same axes merge by adding
+// their counts, so an MPI_SUM reduction of counts() merges them across ranks
+class Histogram {
+public:
+  explicit Histogram(const HistogramAxis& x);
+  Histogram(const HistogramAxis& x, const HistogramAxis& y);
+
+  void add(double x);
+  void add(double x, double y);
+  void addWeighted(double x, double weight);
+  void addWeighted(double x, double y, double weight);
+  void merge(const Histogram& histogram);
+  void clear();
+  std::vector<double>& counts() { return binCounts; }
+
+  // one line per nonzero bin with its edges and count, after a header line
+  void writeCsv(std::ostream& file) const;
+
+private:
+  HistogramAxis xAxis;
+  HistogramAxis yAxis;
+  bool joint;
+  std::vector<double> binCounts;
+};
+
+#endif
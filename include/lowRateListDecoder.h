@@ -3,6 +3,8 @@
 #define LOWRATELISTDECODER_H
 
 #include <climits>
+#include <cstdint>
+#include <limits>
 
 #include "feedForwardTrellis.h"
 #include "minHeap.h"
@@ -11,13 +13,24 @@
 class LowRateListDecoder{
 public:
 	LowRateListDecoder(FeedForwardTrellis FT, int listSize, int crcDegree, int crc, char stopping_rule);
-	MessageInformation lowRateDecoding_MaxListsize(std::vector<double> receivedMessage, std::vector<int> punctured_indices);
-	MessageInformation lowRateDecoding_MaxMetric(std::vector<double> receivedMessage, std::vector<int> punctured_indices);
+	MessageInformation lowRateDecoding_MaxListsize(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing);
+	MessageInformation lowRateDecoding_MaxMetric(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing);
 
-	MessageInformation decode(std::vector<double> receivedMessage, std::vector<int> punctured_indices);
+	MessageInformation lowRateDecoding_MultiTrellis(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing);
+
+	MessageInformation decode(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing);
+	std::vector<MessageInformation> decodeBatch(const std::vector<std::vector<double>>& receivedMessages, const PuncturingPattern& puncturing);
+
+	// steady-state api: the result is overwritten in place and keeps its capacity, so once the
+	// decoder and the results have warmed up a decode does not allocate
+	void decode(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing, MessageInformation& result);
+	void decodeBatch(const std::vector<std::vector<double>>& receivedMessages, const PuncturingPattern& puncturing, std::vector<MessageInformation>& results);
+
+	// records the detour heap operations of every later decode into trace, null to stop
+	void recordHeapTrace(HeapTrace* trace) { workspace.detourTree.record(trace); }
 
 	/* - MLA - */
-	MessageInformation lowRateDecoding_mla(std::vector<double> receivedMessage, std::vector<int> punctured_indices, std::vector<int> transmittedMessage);
+	MessageInformation lowRateDecoding_mla(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing, const std::vector<int>& transmittedMessage);
 
 private:
 	int numForwardPaths;
@@ -29,28 +42,213 @@ private:
 
 	std::vector<std::vector<int>> lowrate_nextStates;
 	std::vector<std::vector<int>> lowrate_outputs;
+	std::vector<double> lowrate_outputPoints; // BPSK point of every output symbol, flat ${numOutputSymbols} x n
 	std::vector<std::vector<int>> neighboring_cwds; // ${listSize} x 516 matrix
 	std::vector<std::vector<int>> neighboring_msgs;  // ${listSize} x 43 matrix
 	std::vector<std::vector<int>> path_ie_state;
 	int lowrate_numStates;
+	int lowrate_numOutputSymbols;
 	int lowrate_symbolLength;
 	int lowrate_pathLength;
 
+	// 24 bytes: metrics first, narrow father states packed behind them
 	struct cell {
-		int optimalFatherState = -1;
-		int suboptimalFatherState = -1;
 		double pathMetric = INT_MAX;
 		double suboptimalPathMetric = INT_MAX;
+		int16_t optimalFatherState = -1;
+		int16_t suboptimalFatherState = -1;
 		bool init = false;
 	};
 
-  std::vector<int> pathToMessage(std::vector<int>); 
-  std::vector<int> pathToCodeword(std::vector<int>); 
-	std::vector<std::vector<cell>> constructLowRateTrellis(std::vector<double> receivedMessage);
-  std::vector<std::vector<cell>> constructLowRateTrellis_Punctured(std::vector<double> receivedMessage, std::vector<int> punctured_indices);
-	std::vector<std::vector<std::vector<cell>>> constructLowRateMultiTrellis(std::vector<double> receivedMessage);
+	void resetTrellis();
+
+	/* - Butterfly trellis - */
+	// a k = 1 feedforward trellis is a shift register: state s on input u goes to (u << (v-1)) | (s >> 1),
+	// so destinations j and j + numStates/2 share the fathers 2j and 2j+1. such a trellis only stores
+	// its path metrics, [stage][state][lane], and the branch metrics of every stage, [stage][output][lane].
+	// the cell of a state is rebuilt from those when the search asks for it, see trellisCell
+	typedef void (LowRateListDecoder::*AcsStageKernel)(const double*, const double*, double*);
+	bool butterflyTrellis;
+	AcsStageKernel acsStage;                // one stage of one frame, vectorized across states
+	AcsStageKernel batchAcsStage;           // one stage of trellisLanes frames, vectorized across frames
+	std::vector<int32_t> butterflyOutputs;  // output symbols as [even,u=0 | odd,u=0 | even,u=1 | odd,u=1], numStates/2 each
+	std::vector<int32_t> butterflyPermutes; // the same, as pairs of 32-bit lane indices (2 * output, 2 * output + 1)
+	int trellisLanes;                       // trellises stored side by side in the path metric array
+	int trellisLane;                        // trellis read by trellisCell
+	int branchLanes;                        // lanes of the branch metric array, 1 when the trellises share it
+	int batchLanes;                         // lanes used by decodeBatch
+	void constructButterflyTrellis(const double* const* receivedMessages, int lanes, const double* puncturingWeights);
+	void selectAcsKernel();
+	template <int HALF> void selectAcsKernels();
+	template <int HALF> void acsStage_scalar(const double* prevPathMetrics, const double* stageBranchMetrics, double* nextPathMetrics);
+	template <int HALF> void acsStage_sse41(const double* prevPathMetrics, const double* stageBranchMetrics, double* nextPathMetrics);
+	template <int HALF> void acsStage_avx2(const double* prevPathMetrics, const double* stageBranchMetrics, double* nextPathMetrics);
+	template <int HALF> void batchAcsStage_scalar(const double* prevPathMetrics, const double* stageBranchMetrics, double* nextPathMetrics);
+	template <int HALF> void batchAcsStage_avx2(const double* prevPathMetrics, const double* stageBranchMetrics, double* nextPathMetrics);
+
+	/* - Multi trellis - */
+	// one butterfly trellis per starting state. lane s only starts from state s and its paths are
+	// only rooted at ending state s, so the search enumerates tail-biting paths alone. slot 0 of the
+	// path metric array holds the single trellis, whose metric at ending state s bounds every path of
+	// lane s from below. the search roots lane s at that bound and builds the lane into the next slot
+	// when the bound is popped, so most lanes of a frame are never built. the lanes share the branch
+	// metrics of the received message
+	bool multiTrellis;
+	int laneOffset;                         // first path metric of the slot trellisCell reads, 0 outside a multi trellis
+	std::vector<int> laneSlots;             // slot of every lane, -1 until it is built
+	int numLaneSlots;
+	void constructLowRateMultiTrellis(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing);
+	void buildLane(int lane);
+	void selectLane(int lane) { laneOffset = laneSlots[lane] * lowrate_pathLength * lowrate_numStates; }
+
+	// paths found by the list search, as a persistent tree: a detour path only stores the states it
+	// traced, stages [0, numNewStates), and shares the later stages with the path it detoured from
+	struct pathNode {
+		int parentPath;    // -1 for a path without detours
+		int numNewStates;
+		int offset;        // first traced state in pathTreeStates
+	};
+
+	/* - Workspace - */
+	// everything a decode writes besides its result. the buffers only grow, so once the decoder has
+	// seen its largest frame, a decode into a caller-owned result allocates nothing. searches past
+	// WORKSPACE_RETAIN_PATHS paths are the exception, their storage is given back, see trimWorkspace
+	struct DecoderWorkspace {
+		// trellis arena of a generic trellis, flat and stage-major: cell (state, stage) lives at
+		// trellisInfo[stage * lowrate_numStates + state]
+		std::vector<cell> trellisInfo;
+		std::vector<double> branchMetrics;        // branch metric of every output symbol at the current stage
+
+		// metrics of a butterfly or multi trellis, see trellisCell
+		std::vector<double> trellisPathMetrics;
+		std::vector<double> trellisBranchMetrics;
+		std::vector<const double*> batchReceivedMessages;
+
+		// detours of the list search
+		MinHeap detourTree;
+
+		// the path tree, see pathNode
+		std::vector<pathNode> pathTree;
+		std::vector<int> pathTreeStates;
+		std::vector<uint32_t> pathTreeSyndromes; // crc syndrome of the message bits from each traced stage to the end
+
+		// a candidate path and its message, materialized for the crc check or an observer
+		std::vector<int> candidatePath;
+		BitVector candidateMessage;
+	};
+	DecoderWorkspace workspace;
+	void trimWorkspace();
+
+	void clearPathTree();
+	int* addPath(int parentPath, int numNewStates);
+	DetourObject popDetour();
+	int pathState(int pathIndex, int stage) const;
+	uint32_t pathSyndrome(int pathIndex, int stage) const;
+	uint32_t* pathSyndromes(int pathIndex) { return &workspace.pathTreeSyndromes[workspace.pathTree[pathIndex].offset]; }
+	void materializePath(int pathIndex, std::vector<int>& path) const;
+
+	// incremental crc: syndrome of every message bit, indexed by the stage the bit leaves from.
+	// the weights are all zero when incrementalCrc is off
+	bool incrementalCrc;
+	int inputBitShift;                      // v - 1, toState >> inputBitShift is the input bit
+	std::vector<uint32_t> syndromeWeights;
+	void prepareSyndromeWeights();
+	uint32_t messageBitSyndrome(int toState, int stage) const;
+
+	// trellis access for the searches, independent of how the trellis is stored
+	cell trellisCell(int state, int stage) const;
+	double trellisPathMetric(int state, int stage) const;
+
+	/* - List search - */
+	// stopping policies, asked before every path
+	struct MaxListsizeStop {
+		explicit MaxListsizeStop(int listSize) : listSize(listSize) {}
+		bool searching(int numPathsSearched, double) const { return numPathsSearched < listSize; }
+		int listSize;
+	};
+	struct MaxMetricStop {
+		explicit MaxMetricStop(double maxMetric) : maxMetric(maxMetric) {}
+		bool searching(int, double metricExplored) const { return metricExplored < maxMetric; }
+		double maxMetric;
+	};
+
+	// observers. candidate sees every searched path, only when everyPath is set, decoded the output
+	// of a search that found a codeword and exceeded the output of one that gave up
+	struct NoObserver {
+		static const bool everyPath = false;
+		void candidate(const std::vector<int>&, MessageInformation&) {}
+		void decoded(MessageInformation&) {}
+		void exceeded(MessageInformation&, int, double) {}
+	};
+	struct MlaObserver {
+		MlaObserver(LowRateListDecoder& decoder, const std::vector<double>& receivedMessage, const std::vector<int>& transmittedMessage, const PuncturingPattern& puncturing);
+		static const bool everyPath = true;
+		void candidate(const std::vector<int>& path, MessageInformation& output);
+		void decoded(MessageInformation& output);
+		void exceeded(MessageInformation& output, int numPathsSearched, double lastPathMetric);
+
+		LowRateListDecoder& decoder;
+		const std::vector<double>& receivedMessage;
+		const std::vector<int>& transmittedMessage;
+		const PuncturingPattern& puncturing;
+	};
+
+	template <typename StopPolicy, typename Observer>
+	void listSearch(const StopPolicy& stop, Observer& observer, MessageInformation& output);
+	bool decodeBestPath(MessageInformation& output);
+
+	// the list search of the stopping rule on the trellis built last, picked by the constructor
+	typedef void (LowRateListDecoder::*TrellisSearch)(MessageInformation&);
+	TrellisSearch trellisSearch;
+	void trellisSearch_MaxListsize(MessageInformation& output);
+	void trellisSearch_MaxMetric(MessageInformation& output);
+
+  void pathToMessage(const std::vector<int>& path, BitVector& message) const;
+  std::vector<int> pathToCodeword(const std::vector<int>& path) const;
+	void constructLowRateTrellis(const std::vector<double>& receivedMessage);
+	void constructLowRateTrellisBatch_Punctured(const std::vector<std::vector<double>>& receivedMessages, int firstFrame, int numFrames, const PuncturingPattern& puncturing);
+  void constructLowRateTrellis_Punctured(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing);
 	std::vector<std::vector<cell>> constructMinimumLikelihoodLowRateTrellis(std::vector<double> receivedMessage);
 };
 
+// syndrome of the message bit on the branch into toState after stage. in a shift register trellis
+// that bit is the leading bit of toState, which is what pathToMessage reads off the branch
+inline uint32_t LowRateListDecoder::messageBitSyndrome(int toState, int stage) const {
+	return syndromeWeights[stage] & (0u - (uint32_t)(toState >> inputBitShift));
+}
+
+inline double LowRateListDecoder::trellisPathMetric(int state, int stage) const {
+	if (!butterflyTrellis)
+		return workspace.trellisInfo[stage * lowrate_numStates + state].pathMetric;
+	return workspace.trellisPathMetrics[laneOffset + (stage * lowrate_numStates + state) * trellisLanes + trellisLane];
+}
+
+inline LowRateListDecoder::cell LowRateListDecoder::trellisCell(int state, int stage) const {
+	if (!butterflyTrellis)
+		return workspace.trellisInfo[stage * lowrate_numStates + state];
+
+	cell stateCell;
+	stateCell.pathMetric = trellisPathMetric(state, stage);
+	stateCell.init = true;
+	if (stage == 0)
+		return stateCell;
+
+	// redoes the add-compare-select of this state, the even father stays optimal on ties
+	int half = lowrate_numStates / 2;
+	int input = state / half;
+	int j = state % half;
+	const double* stageBranchMetrics = &workspace.trellisBranchMetrics[(stage - 1) * lowrate_numOutputSymbols * branchLanes + (branchLanes > 1 ? trellisLane : 0)];
+	double evenMetric = stageBranchMetrics[butterflyOutputs[2 * input * half + j] * branchLanes] + trellisPathMetric(2 * j, stage - 1);
+	double oddMetric  = stageBranchMetrics[butterflyOutputs[(2 * input + 1) * half + j] * branchLanes] + trellisPathMetric(2 * j + 1, stage - 1);
+	bool oddIsOptimal = oddMetric < evenMetric;
+	stateCell.suboptimalPathMetric  = oddIsOptimal ? evenMetric : oddMetric;
+	stateCell.optimalFatherState    = 2 * j + oddIsOptimal;
+	stateCell.suboptimalFatherState = 2 * j + !oddIsOptimal;
+
+	// in a multi trellis a father the lane's starting state cannot reach is no detour
+	if (stateCell.suboptimalPathMetric == std::numeric_limits<double>::infinity())
+		stateCell.suboptimalFatherState = -1;
+	return stateCell;
+}
 
 #endif
@@ -1,38 +1,90 @@
 #ifndef MIN_HEAP_H
 #define MIN_HEAP_H
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 
+// a metric as an unsigned key with the same order: the sign bit is flipped on positive values and
+// every bit on negative ones. the key is exact, unpackMetric gives back the same double
+inline uint64_t packMetric(double metric){
+    uint64_t bits;
+    std::memcpy(&bits, &metric, sizeof(bits));
+    return bits ^ ((uint64_t)((int64_t)bits >> 63) | 0x8000000000000000ull);
+}
+inline double unpackMetric(uint64_t key){
+    uint64_t bits = key ^ (((key >> 63) - 1) | 0x8000000000000000ull);
+    double metric;
+    std::memcpy(&metric, &bits, sizeof(metric));
+    return metric;
+}
+
+// 32 bytes: the metric key and forward metric first, then the narrow fields packed behind them.
+// states and stages are stored in 16 bits, which holds every trellis up to v = 15. a detour stands
+// for the stages [firstStage, lastStage] of its path and is keyed by the best of them, detourStage.
+// roots and eager detours are a single stage, lazy ones a range, see LowRateListDecoder::popDetour
 struct DetourObject{
-    DetourObject(): originalPathIndex(-1) {};
-    double pathMetric;
-    double forwardPathMetric;
-    int detourStage;
-    int startingState;
-    int originalPathIndex;         //path that is being detoured from, defaults to -1 to indicate no detours
-    
-    bool operator<(const DetourObject& obj){
-        return pathMetric < obj.pathMetric;
+    DetourObject(): metricKey(0), forwardPathMetric(0), originalPathIndex(-1), detourStage(0), startingState(0), firstStage(0), lastStage(0) {};
+    uint64_t metricKey;            // packMetric of the path metric
+    double forwardPathMetric;      // at lastStage, at detourStage once popDetour returns it
+    int32_t originalPathIndex;     //path that is being detoured from, defaults to -1 to indicate no detours, -2 for the bound of a multi trellis lane
+    int16_t detourStage;
+    int16_t startingState;
+    int16_t firstStage;
+    int16_t lastStage;
+
+    double pathMetric() const { return unpackMetric(metricKey); }
+    void setPathMetric(double metric) { metricKey = packMetric(metric); }
+
+    // equal metrics pop the roots first, by ending state, then the lane bounds of a multi trellis,
+    // then the detours of the older paths first, and of one path the later stage first. the order
+    // is total, so any heap pops the detours of a search in the same order
+    uint64_t tieKey() const {
+        if (originalPathIndex < 0)
+            return ((uint64_t)(-1 - originalPathIndex) << 16) | (uint16_t)startingState;
+        return ((uint64_t)(originalPathIndex + 2) << 16) | (uint16_t)(0xFFFF - detourStage);
     }
-    bool operator>(const DetourObject& obj){
-        return pathMetric > obj.pathMetric;
+    bool operator<(const DetourObject& obj) const {
+        if (metricKey != obj.metricKey)
+            return metricKey < obj.metricKey;
+        return tieKey() < obj.tieKey();
     }
+    bool operator>(const DetourObject& obj) const {
+        return obj < *this;
+    }
+};
+
+// the operations a heap saw, in order, so the heap traffic of real decodes can be replayed, see
+// tools/heapBenchmark.cpp
+struct HeapTrace{
+    enum Op : uint8_t { INSERT, POP, CLEAR };
+    std::vector<uint8_t> ops;
+    std::vector<DetourObject> inserted;  // the detour of every INSERT, in order
 };
 
+// 8-ary min heap on the path metric. sifting moves a hole instead of swapping, and the storage
+// is kept by clear, so a heap reused across decodes stops allocating once it has grown
 class MinHeap{
 public:
     MinHeap();
-    void insert(DetourObject);
+    void insert(const DetourObject& detour);
     DetourObject pop();
     DetourObject top();
     int size();
+    void reserve(size_t capacity);
+    void clear();
+    void release();
+    void record(HeapTrace* trace);  // appends every later operation to trace, null to stop
 private:
+    static const int ARITY = 8;
     std::vector<DetourObject> detourList;
-    void reHeap(int index);
+    HeapTrace* trace;
+    void siftUp(int index);
+    void siftDown(int index);
     int parentIndex(int index);
-    int rightChildIndex(int index);
-    int leftChildIndex(int index);
+    int firstChildIndex(int index);
 };
 
 
-#endif
\ No newline at end of file
+#endif
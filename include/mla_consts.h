@@ -7,7 +7,7 @@
 /* --- Convolutional Code Parameters --- */
 constexpr int K = 1;                    /* Number of input bits */
 constexpr int N = 2;                    /* Number of output bits */
-constexpr int V = 8;                    /* Number of memory elements */
+constexpr int V = 8;                    /* Number of memory elements, main v poly1 poly2 overrides the code */
 constexpr int M = 12;                   /* Degree of CRC - 1 */
 constexpr unsigned int CRC = 0x1565;    /* CRC polynomial */
 constexpr int POLY1 = 561;              /* Polynomial 1, in decimal*/
@@ -25,12 +25,33 @@ const std::vector<int> PUNCTURING_INDICES
 constexpr int MAX_LISTSIZE = 1e7;      /* Maximum list size */
 constexpr double MAX_METRIC = 84.5;         /* Maximum decoding metric */
 constexpr char STOPPING_RULE = 'M';     /* Stopping rule */
+constexpr int DECODE_BATCH_SIZE = 8;    /* Frames whose trellises are built together, one per SIMD lane */
+constexpr bool LAZY_DETOUR_EXPANSION = true; /* Heap holds the best detour of a range of stages, not every detour of every path */
+constexpr bool MULTI_TRELLIS = false;   /* One trellis per starting state, built on demand, only tail-biting paths are searched */
+constexpr int WORKSPACE_RETAIN_PATHS = 1 << 16; /* Searched paths a decoder keeps the storage of between decodes */
 
 /* --- Simulation Parameters --- */
 constexpr int MAX_ERRORS = 20;           /* Maximum number of errors */
 constexpr bool NOISELESS = false;       /* Noiseless simulation */
 const std::vector<double> EBN0 = {3.35}; /* Eb/N0 values */
 constexpr int LOGGING_ITERS = 1000;     /* Logging Interval*/
+constexpr char OUTPUT_MODE = 'B';       /* 'B' binary per-trial records, 'T' the four text files, 'H' histograms only */
 constexpr int BASE_SEED = 42;           /* Fixed base seed for simulation */
+constexpr int SIM_THREADS = 0;          /* Decoding threads per MPI rank, 0 for one per core */
+constexpr bool DYNAMIC_SCHEDULING = false; /* Rank 0 hands out rounds of any open Eb/N0 point, with 2+ ranks */
+
+/* --- Histogram Parameters, for OUTPUT_MODE 'H' --- */
+constexpr double HIST_METRIC_MIN = 0.0;  /* Lower edge of the metric bins */
+constexpr double HIST_METRIC_MAX = 200.0; /* Upper edge of the metric bins */
+constexpr int HIST_METRIC_BINS = 400;    /* Linear bins between them */
+constexpr int HIST_LISTSIZE_OCTAVES = 24; /* List size bins cover [1, 2^24) */
+constexpr int HIST_LISTSIZE_BINS_PER_OCTAVE = 4; /* Log bins per doubling of the list size */
+
+/* --- Importance Sampling --- */
+constexpr bool IMPORTANCE_SAMPLING = false; /* Shift the noise toward a low-weight error event and weight every trial by its likelihood ratio */
+constexpr double IS_MEAN_SHIFT = 0.75;  /* Noise mean shift on the event symbols, toward the other BPSK point */
+constexpr int IS_EVENT_SPAN = 10;       /* Longest input pattern searched for the lowest-weight event of every bit */
+constexpr double IS_RELATIVE_HALF_WIDTH = 0.3; /* A point stops once the weighted mistake rate's interval is this close, in place of MAX_ERRORS */
+constexpr double CONFIDENCE_Z = 1.96;   /* Normal quantile of the reported confidence intervals, 95% */
 
 #endif
\ No newline at end of file
@@ -8,13 +8,20 @@
 #include <random>
 #include <stdexcept>
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 
 #include "mla_types.h"
+#include "trialRng.h"
 
 namespace awgn {
 
 std::vector<double> addNoise(std::vector<int> encodedMsg, double SNR);
 
+// BPSK of a packed codeword plus noise into noisyMsg, drawing the noise of the trial the rng is on,
+// see TrialRng
+void addNoise(const BitVector& codeword, double SNR, TrialRng& rng, std::vector<double>& noisyMsg);
+
 } // namespace awgn
 
 namespace crc {
@@ -28,11 +35,58 @@ void dec_to_binary(int input, std::vector<int>& output, int bit_number);
 // converts decimal output to n-bit BPSK
 std::vector<int> get_point(int output, int n);
 
+// table-driven crc for one polynomial of crc_bits_num bits, most significant bit first. the
+// remainder register is kept left-aligned in 64 bits, so one byte table serves every degree
+// up to 56, and eight message bits are packed and divided per lookup
+class Engine {
+public:
+	Engine(int crc_bits_num, int crc_dec);
+	int crcBitsNum() const { return crc_bits_num; }
+	int crcDec() const { return crc_dec; }
+
+	// whether the engine can stand in for the bitwise division, see crc_check_reference
+	bool supports(int length) const;
+
+	// remainder of the first length bits, times x^(crc_bits_num - 1), modulo the polynomial
+	uint64_t remainder(const int* bits, int length) const;
+	uint64_t remainder(const BitVector& bits, int length) const;
+
+	// remainder of x^(length - 1 - i) for every bit i of a length-bit message. the remainder of a
+	// message is the sum of the weights of its set bits, and it passes the check when that is zero
+	std::vector<uint64_t> bitWeights(int length) const;
+
+	bool check(const std::vector<int>& input_data) const;
+	void append(std::vector<int>& input_data) const;
+	bool check(const BitVector& input_data) const;
+	void append(BitVector& input_data) const;
+
+private:
+	int crc_bits_num;
+	int crc_dec;
+	int degree;
+	bool leadingBitSet;
+	uint64_t alignedPoly;
+	uint64_t table[256];
+};
+
+// engine for the given polynomial, built on first use and cached per thread
+const Engine& engine(int crc_bits_num, int crc_dec);
+
 // checks the decoded message against the crc
-bool crc_check(std::vector<int> input_data, int crc_bits_num, int crc_dec);
+bool crc_check(const std::vector<int>& input_data, int crc_bits_num, int crc_dec);
 
 void crc_calculation(std::vector<int>& input_data, int crc_bits_num, int crc_dec);
 
+// the same on packed bits. polynomials the engine does not support go through the reference
+bool crc_check(const BitVector& input_data, int crc_bits_num, int crc_dec);
+
+void crc_calculation(BitVector& input_data, int crc_bits_num, int crc_dec);
+
+// bitwise long division, kept to cross-check the table-driven engine
+bool crc_check_reference(std::vector<int> input_data, int crc_bits_num, int crc_dec);
+
+void crc_calculation_reference(std::vector<int>& input_data, int crc_bits_num, int crc_dec);
+
 } // namespace crc
 
 namespace utils {
@@ -46,69 +100,56 @@ void print_int_vector(std::vector<int> vector);
 // outputs a vector of ints to a file
 void output_int_vector(std::vector<int> vector, std::ofstream& file);
 
-// Euclidean distance metric
+// Sum of squared distances, punctured symbols carry zero weight
 template <typename T1, typename T2>
-double euclidean_distance(
+double sum_of_squares(
     const std::vector<T1>& v1, 
     const std::vector<T2>& v2, 
-    const std::vector<int>& punctured_indices) 
+    const PuncturingPattern& puncturing) 
 {
-    if (v1.size() != v2.size()) {
+    if (v1.size() != v2.size() || (int)v1.size() != puncturing.length()) {
         throw std::invalid_argument("Vectors must be of the same size");
     }
 
+    const double* weights = puncturing.weights.data();
     double sum = 0.0;
     for (size_t i = 0; i < v1.size(); i++) {
-        // Skip if index is in punctured_indices
-        if (std::find(punctured_indices.begin(), punctured_indices.end(), i) != punctured_indices.end()) {
-            continue;
-        }
-        sum += std::pow(static_cast<double>(v1[i]) - static_cast<double>(v2[i]), 2);
+        double diff = static_cast<double>(v1[i]) - static_cast<double>(v2[i]);
+        sum += weights[i] * diff * diff;
     }
-    return std::sqrt(sum);
+    return sum;
 }
 
+
+// the same between received symbols and the BPSK of a packed codeword
+double sum_of_squares(const std::vector<double>& received, const BitVector& codeword, const PuncturingPattern& puncturing);
+
 // Euclidean distance metric
 template <typename T1, typename T2>
-double sum_of_squares(
+double euclidean_distance(
     const std::vector<T1>& v1, 
     const std::vector<T2>& v2, 
-    const std::vector<int>& punctured_indices) 
+    const PuncturingPattern& puncturing) 
 {
-    if (v1.size() != v2.size()) {
-        throw std::invalid_argument("Vectors must be of the same size");
-    }
-
-    double sum = 0.0;
-    for (size_t i = 0; i < v1.size(); i++) {
-        // Skip if index is in punctured_indices
-        if (std::find(punctured_indices.begin(), punctured_indices.end(), i) != punctured_indices.end()) {
-            continue;
-        }
-        sum += std::pow(static_cast<double>(v1[i]) - static_cast<double>(v2[i]), 2);
-    }
-    return sum;
+    return std::sqrt(sum_of_squares(v1, v2, puncturing));
 }
 
-
-// Element-wise Squared Distance
+// Element-wise Squared Distance, over the unpunctured symbols only
 template <typename T1, typename T2>
 std::vector<double> elementwise_squared_distance(
     const std::vector<T1>& v1, 
     const std::vector<T2>& v2, 
-    const std::vector<int>& punctured_indices) 
+    const PuncturingPattern& puncturing) 
 {
-    if (v1.size() != v2.size()) {
+    if (v1.size() != v2.size() || (int)v1.size() != puncturing.length()) {
         throw std::invalid_argument("Vectors must be of the same size");
     }
 
-    std::vector<double> distances;
-    for (size_t i = 0; i < v1.size(); i++) {
-        // Skip if index is in punctured_indices
-        if (std::find(punctured_indices.begin(), punctured_indices.end(), i) != punctured_indices.end()) {
-            continue;
-        }
-        distances.push_back(std::pow(static_cast<double>(v1[i]) - static_cast<double>(v2[i]), 2));
+    std::vector<double> distances(puncturing.unpunctured.size());
+    for (size_t j = 0; j < distances.size(); j++) {
+        int i = puncturing.unpunctured[j];
+        double diff = static_cast<double>(v1[i]) - static_cast<double>(v2[i]);
+        distances[j] = diff * diff;
     }
     return distances;
 }
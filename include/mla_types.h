@@ -2,6 +2,9 @@
 #define MLA_TYPES_H
 
 #include <vector>
+#include <stdexcept>
+
+#include "bitVector.h"
 
 struct CodeInformation {
   int k;              // numerator of the rate
@@ -14,9 +17,34 @@ struct CodeInformation {
   std::vector<int> numerators; // optimal code numerators
 };
 
+// puncturing pattern of a codeword, built once from the list of punctured indices so the
+// metrics can weight every symbol instead of searching the index list for it
+struct PuncturingPattern {
+  PuncturingPattern() {};
+  PuncturingPattern(const std::vector<int>& punctured_indices, int length) {
+    indices = punctured_indices;
+    weights = std::vector<double>(length, 1.0);
+    for (size_t i = 0; i < punctured_indices.size(); i++) {
+      if (punctured_indices[i] < 0 || punctured_indices[i] >= length) {
+        throw std::invalid_argument("Puncturing index out of bounds");
+      }
+      weights[punctured_indices[i]] = 0.0;
+    }
+    for (int i = 0; i < length; i++) {
+      if (weights[i] != 0.0)
+        unpunctured.push_back(i);
+    }
+  };
+  int length() const { return (int)weights.size(); }
+
+  std::vector<int> indices;       // punctured indices, as given
+  std::vector<double> weights;    // 0.0 for a punctured symbol, 1.0 otherwise
+  std::vector<int> unpunctured;   // indices of the symbols that are kept, in order
+};
+
 struct MessageInformation{
 	MessageInformation() {
-		message 					= std::vector<int>();
+		message 					= BitVector();
 		path 							= std::vector<int>();
 		listSize 					= -1;
     TBListSize        = -1;
@@ -27,7 +55,18 @@ struct MessageInformation{
 		pathToTransmittedCodewordHistory = std::vector<double>();
 		decodedCodewordSquaredNoiseMag 	= std::vector<double>();
 	};
-	std::vector<int> message;
+	// resets the fields like the constructor, but the vectors keep their capacity
+	void clear() {
+		message.clear();
+		path.clear();
+		listSize 					= -1;
+    TBListSize        = -1;
+		listSizeExceeded 	= false;
+		metric 						= -1.0;
+		pathToTransmittedCodewordHistory.clear();
+		decodedCodewordSquaredNoiseMag.clear();
+	};
+	BitVector message;            // packed, one bit per trellis stage
 	std::vector<int> path;
 	int listSize;
   int TBListSize;
@@ -0,0 +1,63 @@
+#ifndef RECORD_WRITER_H
+#define RECORD_WRITER_H
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "trialRecords.h"
+
+// record files of one Eb/N0 point on one rank, a binary record file or the four text files
+// depending on OUTPUT_MODE
+struct PointFiles {
+	PointFiles(int rank, double EbN0);
+	void write(std::vector<TrialRecord>& records);
+	std::ofstream recordFile;
+	std::ofstream RRVtoTransmitted_MetricFile;
+	std::ofstream RRVtoDecoded_MetricFile;
+	std::ofstream RRVtoDecoded_ListSizeFile;
+	std::ofstream RRVtoDecoded_DecodeTypeFile;
+};
+
+// background thread that writes the records of finished rounds, so decoding never waits on the
+// files. the simulation fills one buffer while the writer drains the other, and a handoff only
+// waits when the writer is still busy with the previous round, which the stats count as back-pressure
+class RecordWriter {
+public:
+	RecordWriter();
+	~RecordWriter();  // drains, then stops the thread
+
+	// hands the records of a round, in task order, to the writer and leaves the task vectors empty
+	void submit(PointFiles* files, std::vector<std::vector<TrialRecord>>& taskRecords);
+
+	// waits until everything submitted is written, call it before closing a PointFiles
+	void drain();
+
+	struct Stats {
+		long long rounds;
+		long long records;
+		long long stalledRounds;  // handoffs that waited for the writer
+		double stallSeconds;      // time the simulation spent in those waits
+		double writeSeconds;      // time the writer spent writing
+	};
+	Stats stats();
+
+private:
+	std::vector<TrialRecord> fillBuffer;   // owned by the submitting thread
+	std::vector<TrialRecord> writeBuffer;  // owned by the writer while pending
+	PointFiles* writeTarget;
+
+	std::mutex mutex;
+	std::condition_variable roundPending;
+	std::condition_variable roundWritten;
+	bool pending;
+	bool stopping;
+	Stats counters;
+	std::thread thread;
+
+	void writerLoop();
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef TRIAL_RECORDS_H
+#define TRIAL_RECORDS_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// binary record file: a RecordFileHeader, then one fixed-width TrialRecord per tallied trial, so a
+// file can be read, merged and joined row by row. values are in the byte order of the writer
+constexpr char RECORD_FILE_MAGIC[8] = {'M', 'L', 'A', 'R', 'E', 'C', 'S', '\0'};
+constexpr uint32_t RECORD_FILE_VERSION = 2;
+
+struct RecordFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;  // sizeof(TrialRecord) of the writer
+  double EbN0;
+  int32_t rank;         // rank that wrote the records, -1 for a merged file
+  int32_t reserved;
+};
+
+// one trial. list size and metric are kept for every decode type, as the decoder returned them
+struct TrialRecord {
+  int64_t trialId;      // TrialRng trial index, with the rank and Eb/N0 point it regenerates the trial
+  double transmittedMetric;
+  double decodedMetric;
+  int32_t listSize;
+  int32_t TBListSize;
+  int32_t decodedType;  // 0 correct, 1 list size exceeded, 2 incorrect
+  int32_t rank;
+  double logWeight;     // log likelihood ratio of the trial under IMPORTANCE_SAMPLING, 0 otherwise
+};
+
+static_assert(sizeof(RecordFileHeader) == 32, "record file header must stay 32 bytes");
+static_assert(sizeof(TrialRecord) == 48, "trial records must stay 48 bytes");
+
+namespace records {
+
+RecordFileHeader makeHeader(double EbN0, int rank);
+
+void writeHeader(std::ostream& file, const RecordFileHeader& header);
+
+void writeRecords(std::ostream& file, const std::vector<TrialRecord>& records);
+
+// reads a whole record file, throws std::runtime_error if it is not one of this version
+void readFile(const std::string& filename, RecordFileHeader& header, std::vector<TrialRecord>& records);
+
+// one line per record, with a header line
+void writeCsv(std::ostream& file, const std::vector<TrialRecord>& records);
+
+} // namespace records
+
+#endif
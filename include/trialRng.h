@@ -0,0 +1,52 @@
+#ifndef TRIAL_RNG_H
+#define TRIAL_RNG_H
+
+#include <cstdint>
+
+// counter-based random numbers, Philox4x32-10. the key is (seed, rank) and the counter is
+// (trial index, Eb/N0 point, stream, block), so the draws of any trial can be regenerated from its
+// index alone, and ranks, threads and trials never share a stream. a generator holds no state
+// besides the trial it is on
+class TrialRng {
+public:
+  TrialRng(uint32_t seed, uint32_t rank);
+
+  // starts the draws of one trial, every stream restarts at its first block
+  void startTrial(uint64_t trialIndex, uint32_t ebn0Index);
+
+  // n uniform bits packed 64 to a word, bit i at bit i % 64 of word i / 64. the rest of the last
+  // word is zero
+  void bits(uint64_t* output, int n);
+
+  // n samples of N(0, sigma^2), Box-Muller over batches of Philox blocks. the logarithm, sine and
+  // cosine are polynomials within a few ulp of the math library, the same on every kernel
+  void normals(double* output, int n, double sigma);
+
+  // a uniform integer in [0, n) from the sampling stream, for the choices of importance sampling.
+  // it leaves the bit and normal streams alone, so a trial keeps its message and noise. one block
+  // per draw, multiplied down, the bias is below n / 2^32
+  uint32_t uniformIndex(uint32_t n);
+
+  // one Philox4x32-10 block, exposed for testing against the reference vectors
+  static void block(const uint32_t counter[4], const uint32_t key[2], uint32_t output[4]);
+
+private:
+  enum Stream { BIT_STREAM = 0, NORMAL_STREAM = 1, SAMPLING_STREAM = 2 };
+  static const int BATCH_BLOCKS = 8;  // blocks generated together, one per vector lane
+
+  uint32_t key[2];
+  uint64_t trialIndex;
+  uint32_t ebn0Index;
+  uint32_t nextBlock[3];  // next block of each stream in the current trial
+
+  // Box-Muller pairs of a batch, output[2 * block] and output[2 * block + 1]. the kernels are one
+  // lane loop compiled for each instruction set, picked by the constructor
+  typedef void (*BoxMullerKernel)(const uint32_t words[4][BATCH_BLOCKS], double sigma, double* output);
+  BoxMullerKernel boxMuller;
+  static void boxMuller_scalar(const uint32_t words[4][BATCH_BLOCKS], double sigma, double* output);
+  static void boxMuller_avx2(const uint32_t words[4][BATCH_BLOCKS], double sigma, double* output);
+
+  void nextBlocks(Stream stream, uint32_t output[4][BATCH_BLOCKS]);
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of threads that run rounds of indexed tasks. every worker owns a deque of task
+// indices, takes from its front and, once it runs dry, steals from the back of the others,
+// so a few slow tasks do not hold up the ones queued behind them
+class WorkStealingPool{
+public:
+    // numThreads workers, the thread calling run is worker 0
+    explicit WorkStealingPool(int numThreads);
+    ~WorkStealingPool();
+    int size() const;
+
+    // runs task(worker, index) for every index in [0, numTasks) and returns once all of them
+    // ran. worker identifies the thread, so tasks can keep per-thread state without locking.
+    // the first exception a task throws is rethrown here
+    void run(int numTasks, const std::function<void(int, int)>& task);
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+    std::vector<WorkerQueue> queues;
+    std::vector<std::thread> threads;
+
+    // round state, guarded by mutex
+    std::mutex mutex;
+    std::condition_variable roundStarted;
+    std::condition_variable roundFinished;
+    const std::function<void(int, int)>* task;
+    int round;
+    int busyWorkers;
+    bool stopping;
+    std::exception_ptr taskException;
+    std::atomic<bool> taskFailed;  // taskException is set, read without the mutex between tasks
+
+    void workerLoop(int worker);
+    void runTasks(int worker);
+    bool nextTask(int worker, int& index);
+};
+
+#endif
@@ -0,0 +1,26 @@
+#include "../include/bitVector.h"
+
+void BitVector::reset(int numBits) {
+  this->numBits = numBits;
+  bitWords.assign(wordsFor(numBits), 0);
+}
+
+void BitVector::resize(int numBits) {
+  bitWords.resize(wordsFor(numBits), 0);
+  this->numBits = numBits;
+  if (numBits % 64 != 0)
+    bitWords.back() &= (1ull << (numBits % 64)) - 1;
+}
+
+BitVector BitVector::fromInts(const std::vector<int>& bits) {
+  BitVector packed(bits.size());
+  for (size_t i = 0; i < bits.size(); i++)
+    packed.bitWords[i >> 6] |= (uint64_t)(bits[i] & 1) << (i & 63);
+  return packed;
+}
+
+void BitVector::toInts(std::vector<int>& bits) const {
+  bits.resize(numBits);
+  for (int i = 0; i < numBits; i++)
+    bits[i] = get(i);
+}
@@ -0,0 +1,85 @@
+#include "../include/errorEventSampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "../include/feedForwardTrellis.h"
+#include "../include/mla_namespace.h"
+
+ErrorEventSampler::ErrorEventSampler(CodeInformation code, const PuncturingPattern& puncturing, int maxSpan, double shift)
+    : shift(shift) {
+  FeedForwardTrellis trellis(code.k, code.n, code.v, code.numerators);
+  int messageLength = code.numInfoBits + code.crcDeg - 1;
+  if (maxSpan < 1 || maxSpan > messageLength)
+    throw std::invalid_argument("Error event span out of range");
+
+  // the encoder is linear, so an input pattern's codeword is the event it causes on any message.
+  // patterns wrap around the end of the message like the tail-biting trellis does
+  BitVector pattern, codeword;
+  events.resize(messageLength);
+  for (int first = 0; first < messageLength; first++) {
+    for (int span = 1; span <= maxSpan; span++) {
+      int inner = std::max(span - 2, 0);
+      for (int innerBits = 0; innerBits < (1 << inner); innerBits++) {
+        pattern.reset(messageLength);
+        pattern.set(first, 1);
+        pattern.set((first + span - 1) % messageLength, 1);
+        for (int bit = 0; bit < inner; bit++)
+          pattern.set((first + 1 + bit) % messageLength, (innerBits >> bit) & 1);
+        trellis.encode(pattern, codeword);
+
+        std::vector<int> symbols;
+        for (int i : puncturing.unpunctured) {
+          if (codeword.get(i))
+            symbols.push_back(i);
+        }
+        if (events[first].empty() || symbols.size() < events[first].size())
+          events[first] = symbols;
+      }
+    }
+  }
+}
+
+// with the symbols s_i = +-1 of the codeword and the noise n_i, the event e has mean -shift * s_i on
+// its symbols, so log q_e/p = -(shift * sum s_i n_i + |e| shift^2 / 2) / sigma^2 summed over e
+double ErrorEventSampler::addNoise(const BitVector& codeword, double SNR, TrialRng& rng, std::vector<double>& received) const {
+  double variance = pow(10.0, -SNR / 10.0);
+  int event = (int)rng.uniformIndex((uint32_t)events.size());
+  awgn::addNoise(codeword, SNR, rng, received);
+  for (int i : events[event])
+    received[i] -= (1 - 2 * codeword.get(i)) * shift;
+
+  // log-sum-exp in two passes, the largest exponent and then the sum under it, so a trial allocates
+  // nothing
+  double largest = -HUGE_VAL;
+  for (size_t e = 0; e < events.size(); e++)
+    largest = std::max(largest, eventExponent(e, codeword, received, variance));
+  double mixture = 0.0;
+  for (size_t e = 0; e < events.size(); e++)
+    mixture += exp(eventExponent(e, codeword, received, variance) - largest);
+  return -(largest + log(mixture / events.size()));
+}
+
+double ErrorEventSampler::eventExponent(size_t event, const BitVector& codeword, const std::vector<double>& received, double variance) const {
+  double projection = 0.0;
+  for (int i : events[event]) {
+    int symbol = 1 - 2 * codeword.get(i);
+    projection += symbol * (received[i] - symbol);
+  }
+  return -(shift * projection + events[event].size() * shift * shift / 2.0) / variance;
+}
+
+int ErrorEventSampler::minEventWeight() const {
+  size_t weight = events[0].size();
+  for (const std::vector<int>& symbols : events)
+    weight = std::min(weight, symbols.size());
+  return (int)weight;
+}
+
+int ErrorEventSampler::maxEventWeight() const {
+  size_t weight = 0;
+  for (const std::vector<int>& symbols : events)
+    weight = std::max(weight, symbols.size());
+  return (int)weight;
+}
@@ -7,6 +7,7 @@
 #include <cmath>
 #include <queue>
 #include <algorithm>
+#include <stdexcept>
 
 FeedForwardTrellis::FeedForwardTrellis(int k, int n, int v, std::vector<int> numerators){
 	this->k = k;
@@ -15,18 +16,17 @@ FeedForwardTrellis::FeedForwardTrellis(int k, int n, int v, std::vector<int> num
 	for (int i = 0; i < numerators.size(); i++){
 		this->numerators.push_back(numerators[i]);
 	}
+	// the decoders store states as int16_t
+	if(v < 1 || v > 15)
+		throw std::invalid_argument("FeedForwardTrellis: v must be in [1, 15]");
 	this->numInputSymbols = pow(2.0, k);
 	this->numOutputSymbols = pow(2.0, n);
 	this->numStates = pow(2.0, v);
 	this->nextStates = std::vector<std::vector<int>>(numStates, std::vector<int>(numInputSymbols));
 	this->outputs = std::vector<std::vector<int>>(numStates, std::vector<int>(numInputSymbols));
 
-
-	if(v != V){
-		std::cout << "MAJOR ISSUE: CONST V DOES NOT MATCH v. EDIT IN FeedForwardTrellis" << std::endl;
-		exit(1);
-	}
 	computeNextStates();
+	computeEncoderTables();
 }
 
 void FeedForwardTrellis::computeNextStates(){
@@ -56,15 +56,15 @@ void FeedForwardTrellis::computeNextStates(){
                 output[i] = 0;
             }
             for (int x_bit = 0; x_bit < n; x_bit ++){
-                for (int m_bit = 0; m_bit < V+1; m_bit ++){
+                for (int m_bit = 0; m_bit < v+1; m_bit ++){
                     if (bin_numerators[x_bit][m_bit] == 1){
                         output[x_bit] ^= mem_elements[m_bit];
                     }
                 }
             }
             outputs[currentState][input] = bin2Dec(output);
-            std::vector<int> temp(V);
-            for (int i=0; i<V; i++){
+            std::vector<int> temp(v);
+            for (int i=0; i<v; i++){
                 temp[i] = mem_elements[i];
                 // std::cout << temp[i] << std::endl;
             }
@@ -74,30 +74,125 @@ void FeedForwardTrellis::computeNextStates(){
 }
 
 
-std::vector<int> FeedForwardTrellis::encode(std::vector<int> originalMessage){
-	// brute force approach, there is a better way to do this assuming invertibility
-	// that allows us to precompute starting / ending states, reducing complexity in
-	// each encoding from O(numStates) to O(2). revisit when available
+// flattens the transition tables and packs every output least significant bit first, the order of
+// a packed codeword, so encoding is two table lookups per input symbol
+void FeedForwardTrellis::computeEncoderTables(){
+	nextStateTable.resize(numStates * numInputSymbols);
+	outputBits.resize(numStates * numInputSymbols);
+	for (int state = 0; state < numStates; state++){
+		for (int input = 0; input < numInputSymbols; input++){
+			int branch = state * numInputSymbols + input;
+			nextStateTable[branch] = nextStates[state][input];
+			outputBits[branch] = 0;
+			for (int j = 0; j < n; j++)
+				outputBits[branch] |= (uint64_t)((outputs[state][input] >> (n - 1 - j)) & 1) << j;
+		}
+	}
+	memorySymbols = (v + k - 1) / k;
+}
+
+// the input symbol at a symbol index of the message, k bits with the first one most significant
+inline int FeedForwardTrellis::inputSymbol(const BitVector& message, int symbol) const {
+	int decimal = 0;
+	for (int j = 0; j < k; j++)
+		decimal = (decimal << 1) | message.get(symbol * k + j);
+	return decimal;
+}
+
+// a feedforward encoder's state is its last inputs, whatever it started from. the state the message
+// ends in, and so the state a tail-biting codeword starts in, is the one its last memorySymbols
+// input symbols lead to from any state
+inline int FeedForwardTrellis::tailBitingState(const BitVector& message) const {
+	int numSymbols = message.size() / k;
+	int state = 0;
+	for (int symbol = numSymbols - memorySymbols; symbol < numSymbols; symbol++)
+		state = nextStateTable[state * numInputSymbols + inputSymbol(message, symbol)];
+	return state;
+}
+
+// the n output bits of a branch go to codeword bit position, spilling into the next word
+inline void FeedForwardTrellis::appendOutput(uint64_t* words, int position, int branch) const {
+	words[position >> 6] |= outputBits[branch] << (position & 63);
+	if ((position & 63) + n > 64)
+		words[(position >> 6) + 1] |= outputBits[branch] >> (64 - (position & 63));
+}
+
+// the tail-biting codeword of a message in BPSK, for callers with one int per bit
+std::vector<int> FeedForwardTrellis::encode(const std::vector<int>& originalMessage){
+	BitVector codeword;
+	encode(BitVector::fromInts(originalMessage), codeword);
+	std::vector<int> points(codeword.size());
+	for (int i = 0; i < codeword.size(); i++)
+		points[i] = 1 - 2 * codeword.get(i);
+	return points;
+}
+
+// the tail-biting codeword bits of a packed message, into codeword
+void FeedForwardTrellis::encode(const BitVector& originalMessage, BitVector& codeword){
+	int numSymbols = originalMessage.size() / k;
+	if (numSymbols < memorySymbols){
+		encodeBruteForce(originalMessage, codeword);
+		return;
+	}
+
+	codeword.reset(numSymbols * n);
+	uint64_t* words = codeword.words();
+	int state = tailBitingState(originalMessage);
+	for (int symbol = 0; symbol < numSymbols; symbol++){
+		int branch = state * numInputSymbols + inputSymbol(originalMessage, symbol);
+		appendOutput(words, symbol * n, branch);
+		state = nextStateTable[branch];
+	}
+}
+
+// encodes many messages, stepping through all of them one input symbol at a time. the messages'
+// encoders are independent, so their table lookups overlap instead of waiting on each other
+void FeedForwardTrellis::encodeBatch(const std::vector<BitVector>& originalMessages, std::vector<BitVector>& codewords){
+	int numMessages = originalMessages.size();
+	codewords.resize(numMessages);
+	int numSymbols = numMessages > 0 ? originalMessages[0].size() / k : 0;
+	bool sameLength = true;
+	for (int i = 0; i < numMessages; i++)
+		sameLength = sameLength && originalMessages[i].size() == numSymbols * k;
+	if (!sameLength || numSymbols < memorySymbols){
+		for (int i = 0; i < numMessages; i++)
+			encode(originalMessages[i], codewords[i]);
+		return;
+	}
+
+	if ((int)batchStates.size() < numMessages)
+		batchStates.resize(numMessages);
+	int* states = batchStates.data();
+	for (int i = 0; i < numMessages; i++){
+		codewords[i].reset(numSymbols * n);
+		states[i] = tailBitingState(originalMessages[i]);
+	}
+	for (int symbol = 0; symbol < numSymbols; symbol++){
+		for (int i = 0; i < numMessages; i++){
+			int branch = states[i] * numInputSymbols + inputSymbol(originalMessages[i], symbol);
+			appendOutput(codewords[i].words(), symbol * n, branch);
+			states[i] = nextStateTable[branch];
+		}
+	}
+}
 
+// tries every starting state until the message ends where it started. only messages shorter than
+// the memory take it, their starting state is not determined by their last inputs
+void FeedForwardTrellis::encodeBruteForce(const BitVector& originalMessage, BitVector& codeword){
+	int numSymbols = originalMessage.size() / k;
 	for (int m = 0; m < numStates; m++){
-		std::vector<int> output;
+		codeword.reset(numSymbols * n);
 		int State = m;
-		for (int i = 0; i < originalMessage.size(); i += k){
-			int decimal = 0;
-			for (int j = 0; j < k; j++){
-				decimal += (originalMessage[i + j] * pow(2, k - j - 1));
-			}
-			std::vector<int> outputBinary = crc::get_point(outputs[State][decimal], n);
-			State = nextStates[State][decimal];
-			for (int j = 0; j < n; j++){
-				output.push_back(outputBinary[j]);
-			}
+		for (int symbol = 0; symbol < numSymbols; symbol++){
+			int branch = State * numInputSymbols + inputSymbol(originalMessage, symbol);
+			appendOutput(codeword.words(), symbol * n, branch);
+			State = nextStateTable[branch];
 		}
 		if (m == State) {
-			return output;
+			return;
 		}
 	}
-	return originalMessage;
+	codeword = originalMessage;
 }
 
 std::vector<int> FeedForwardTrellis::dec2Bin(int decimal, int length){
@@ -0,0 +1,102 @@
+#include "../include/histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+HistogramAxis::HistogramAxis(bool logarithmic, double min, double max, int numBins, double binsPerUnit)
+  : logarithmic(logarithmic), min(min), max(max), numBins(numBins), binsPerUnit(binsPerUnit) {
+  if (numBins <= 0 || !(max > min) || (logarithmic && min <= 0))
+    throw std::invalid_argument("Invalid histogram axis");
+}
+
+HistogramAxis HistogramAxis::linear(double min, double max, int numBins) {
+  return HistogramAxis(false, min, max, numBins, numBins / (max - min));
+}
+
+HistogramAxis HistogramAxis::log2(double min, int octaves, int binsPerOctave) {
+  return HistogramAxis(true, min, min * std::pow(2.0, octaves), octaves * binsPerOctave, binsPerOctave);
+}
+
+int HistogramAxis::bin(double value) const {
+  if (!(value >= min))
+    return 0;
+  if (value >= max)
+    return numBins + 1;
+  double position = logarithmic ? std::log2(value / min) * binsPerUnit : (value - min) * binsPerUnit;
+  int index = (int)position;
+  // rounding can put a value next to an edge into the bin on the other side
+  if (index > 0 && value < edge(index))
+    index--;
+  else if (index + 1 < numBins && value >= edge(index + 1))
+    index++;
+  return 1 + std::min(index, numBins - 1);
+}
+
+// lower edge of the regular bin index, index numBins is max
+double HistogramAxis::edge(int index) const {
+  if (index >= numBins)
+    return max;
+  return logarithmic ? min * std::pow(2.0, index / binsPerUnit) : min + index / binsPerUnit;
+}
+
+double HistogramAxis::lowerEdge(int bin) const {
+  if (bin == 0)
+    return -std::numeric_limits<double>::infinity();
+  return edge(bin - 1);
+}
+
+double HistogramAxis::upperEdge(int bin) const {
+  if (bin > numBins)
+    return std::numeric_limits<double>::infinity();
+  return edge(bin);
+}
+
+bool HistogramAxis::operator==(const HistogramAxis& axis) const {
+  return logarithmic == axis.logarithmic && min == axis.min && max == axis.max && numBins == axis.numBins;
+}
+
+Histogram::Histogram(const HistogramAxis& x)
+  : xAxis(x), yAxis(HistogramAxis::linear(0.0, 1.0, 1)), joint(false), binCounts(x.size(), 0.0) {}
+
+Histogram::Histogram(const HistogramAxis& x, const HistogramAxis& y)
+  : xAxis(x), yAxis(y), joint(true), binCounts(x.size() * y.size(), 0.0) {}
+
+void Histogram::add(double x) { binCounts[xAxis.bin(x)] += 1.0; }
+
+void Histogram::add(double x, double y) { binCounts[xAxis.bin(x) * yAxis.size() + yAxis.bin(y)] += 1.0; }
+
+void Histogram::addWeighted(double x, double weight) { binCounts[xAxis.bin(x)] += weight; }
+
+void Histogram::addWeighted(double x, double y, double weight) { binCounts[xAxis.bin(x) * yAxis.size() + yAxis.bin(y)] += weight; }
+
+void Histogram::merge(const Histogram& histogram) {
+  if (!(xAxis == histogram.xAxis) || !(yAxis == histogram.yAxis) || joint != histogram.joint)
+    throw std::invalid_argument("Histograms have different bins");
+  for (size_t i = 0; i < binCounts.size(); i++)
+    binCounts[i] += histogram.binCounts[i];
+}
+
+void Histogram::clear() { std::fill(binCounts.begin(), binCounts.end(), 0.0); }
+
+void Histogram::writeCsv(std::ostream& file) const {
+  file.precision(17);
+  if (!joint) {
+    file << "lower,upper,count\n";
+    for (int x = 0; x < xAxis.size(); x++) {
+      if (binCounts[x] != 0)
+        file << xAxis.lowerEdge(x) << ',' << xAxis.upperEdge(x) << ',' << binCounts[x] << '\n';
+    }
+    return;
+  }
+
+  file << "x_lower,x_upper,y_lower,y_upper,count\n";
+  for (int x = 0; x < xAxis.size(); x++) {
+    for (int y = 0; y < yAxis.size(); y++) {
+      double count = binCounts[x * yAxis.size() + y];
+      if (count != 0)
+        file << xAxis.lowerEdge(x) << ',' << xAxis.upperEdge(x) << ',' << yAxis.lowerEdge(y) << ',' << yAxis.upperEdge(y) << ',' << count << '\n';
+    }
+  }
+}
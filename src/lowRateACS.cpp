@@ -0,0 +1,215 @@
+#include "../include/lowRateListDecoder.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MLA_X86_ACS
+#endif
+
+/* Radix-2 butterfly add-compare-select for one trellis stage.
+
+	For destination j < numStates/2 on input u, the fathers are 2j and 2j+1, and the destination is
+	j + u * numStates/2. The kernels only write the surviving path metric of every destination. The
+	father decisions are redone by trellisCell when the search visits a state, with the even father
+	kept on ties as in the generic state loop of constructLowRateTrellis_Punctured.
+
+	Every kernel is a template on HALF = numStates/2, the number of butterflies, with HALF = 0 for
+	the size read from lowrate_numStates at run time. A butterfly trellis has k = 1, so the kernels
+	always have two inputs.
+
+	The acsStage kernels handle one frame and vectorize across states. The batchAcsStage kernels
+	handle trellisLanes frames laid out [state][lane] and vectorize across frames, so all their loads
+	and stores are contiguous.
+*/
+
+// picks the widest kernels the CPU supports, the scalar kernels are the fallback
+template <int HALF>
+void LowRateListDecoder::selectAcsKernels(){
+	acsStage = &LowRateListDecoder::acsStage_scalar<HALF>;
+	batchAcsStage = &LowRateListDecoder::batchAcsStage_scalar<HALF>;
+#ifdef MLA_X86_ACS
+	if (__builtin_cpu_supports("avx2")) {
+		acsStage = &LowRateListDecoder::acsStage_avx2<HALF>;
+		batchAcsStage = &LowRateListDecoder::batchAcsStage_avx2<HALF>;
+	}
+	else if (__builtin_cpu_supports("sse4.1"))
+		acsStage = &LowRateListDecoder::acsStage_sse41<HALF>;
+#endif
+}
+
+// codes with v = 6 .. 12 get kernels whose state loops have a constant trip count, the compiler
+// unrolls them and drops the remainder checks of the vector kernels. other sizes use the kernels
+// sized at run time, HALF = 0
+void LowRateListDecoder::selectAcsKernel(){
+	switch(lowrate_numStates){
+		case 64:   selectAcsKernels<32>();   break;
+		case 128:  selectAcsKernels<64>();   break;
+		case 256:  selectAcsKernels<128>();  break;
+		case 512:  selectAcsKernels<256>();  break;
+		case 1024: selectAcsKernels<512>();  break;
+		case 2048: selectAcsKernels<1024>(); break;
+		case 4096: selectAcsKernels<2048>(); break;
+		default:   selectAcsKernels<0>();    break;
+	}
+}
+
+template <int HALF>
+void LowRateListDecoder::acsStage_scalar(const double* prevPathMetrics, const double* stageBranchMetrics, double* nextPathMetrics){
+	const int half = HALF > 0 ? HALF : lowrate_numStates / 2;
+	for(int input = 0; input < 2; input++){
+		const int32_t* evenOutputs = &butterflyOutputs[2 * input * half];
+		const int32_t* oddOutputs  = evenOutputs + half;
+		for(int j = 0; j < half; j++){
+			double evenMetric = stageBranchMetrics[evenOutputs[j]] + prevPathMetrics[2 * j];
+			double oddMetric  = stageBranchMetrics[oddOutputs[j]] + prevPathMetrics[2 * j + 1];
+			nextPathMetrics[input * half + j] = oddMetric < evenMetric ? oddMetric : evenMetric;
+		}
+	}
+}
+
+template <int HALF>
+void LowRateListDecoder::batchAcsStage_scalar(const double* prevPathMetrics, const double* stageBranchMetrics, double* nextPathMetrics){
+	const int half = HALF > 0 ? HALF : lowrate_numStates / 2;
+	int lanes = trellisLanes;
+	for(int input = 0; input < 2; input++){
+		const int32_t* evenOutputs = &butterflyOutputs[2 * input * half];
+		const int32_t* oddOutputs  = evenOutputs + half;
+		for(int j = 0; j < half; j++){
+			const double* evenFathers = prevPathMetrics + 2 * j * lanes;
+			const double* oddFathers  = evenFathers + lanes;
+			const double* evenBranch  = stageBranchMetrics + evenOutputs[j] * lanes;
+			const double* oddBranch   = stageBranchMetrics + oddOutputs[j] * lanes;
+			double* next = nextPathMetrics + (input * half + j) * lanes;
+			for(int lane = 0; lane < lanes; lane++){
+				double evenMetric = evenBranch[lane] + evenFathers[lane];
+				double oddMetric  = oddBranch[lane] + oddFathers[lane];
+				next[lane] = oddMetric < evenMetric ? oddMetric : evenMetric;
+			}
+		}
+	}
+}
+
+#ifdef MLA_X86_ACS
+
+// the minimum of the two candidates is the same value whichever father wins a tie, so min_pd can be used
+
+template <int HALF>
+__attribute__((target("sse4.1")))
+void LowRateListDecoder::acsStage_sse41(const double* prevPathMetrics, const double* stageBranchMetrics, double* nextPathMetrics){
+	const int half = HALF > 0 ? HALF : lowrate_numStates / 2;
+	if(half % 2 != 0){
+		acsStage_scalar<HALF>(prevPathMetrics, stageBranchMetrics, nextPathMetrics);
+		return;
+	}
+	const double* bm = stageBranchMetrics;
+	for(int input = 0; input < 2; input++){
+		const int32_t* evenOutputs = &butterflyOutputs[2 * input * half];
+		const int32_t* oddOutputs  = evenOutputs + half;
+		for(int j = 0; j < half; j += 2){
+			// fathers 2j .. 2j+3, split into the even and odd father of destinations j, j+1
+			__m128d a = _mm_loadu_pd(prevPathMetrics + 2 * j);
+			__m128d b = _mm_loadu_pd(prevPathMetrics + 2 * j + 2);
+			__m128d evenFathers = _mm_unpacklo_pd(a, b);
+			__m128d oddFathers  = _mm_unpackhi_pd(a, b);
+
+			__m128d evenBranch = _mm_set_pd(bm[evenOutputs[j + 1]], bm[evenOutputs[j]]);
+			__m128d oddBranch  = _mm_set_pd(bm[oddOutputs[j + 1]], bm[oddOutputs[j]]);
+			__m128d evenMetric = _mm_add_pd(evenBranch, evenFathers);
+			__m128d oddMetric  = _mm_add_pd(oddBranch, oddFathers);
+			_mm_storeu_pd(nextPathMetrics + input * half + j, _mm_min_pd(oddMetric, evenMetric));
+		}
+	}
+}
+
+template <int HALF>
+__attribute__((target("avx2")))
+void LowRateListDecoder::acsStage_avx2(const double* prevPathMetrics, const double* stageBranchMetrics, double* nextPathMetrics){
+	const int half = HALF > 0 ? HALF : lowrate_numStates / 2;
+	if(half % 4 != 0){
+		acsStage_scalar<HALF>(prevPathMetrics, stageBranchMetrics, nextPathMetrics);
+		return;
+	}
+	const double* bm = stageBranchMetrics;
+
+	// with at most 4 output symbols the whole branch metric table fits in one register, and a
+	// cross-lane permute of its 32-bit halves picks the branch metric of every destination
+	bool permuteBranches = lowrate_numOutputSymbols <= 4;
+	double branchTable[4] = {0, 0, 0, 0};
+	for(int output = 0; permuteBranches && output < lowrate_numOutputSymbols; output++)
+		branchTable[output] = bm[output];
+	__m256 branches = _mm256_castpd_ps(_mm256_loadu_pd(branchTable));
+
+	for(int j = 0; j < half; j += 4){
+		// fathers 2j .. 2j+7, split into the even and odd father of destinations j .. j+3.
+		// unpack yields lanes (j, j+2, j+1, j+3), the permute restores (j, j+1, j+2, j+3)
+		__m256d a = _mm256_loadu_pd(prevPathMetrics + 2 * j);
+		__m256d b = _mm256_loadu_pd(prevPathMetrics + 2 * j + 4);
+		__m256d evenFathers = _mm256_permute4x64_pd(_mm256_unpacklo_pd(a, b), 0xD8);
+		__m256d oddFathers  = _mm256_permute4x64_pd(_mm256_unpackhi_pd(a, b), 0xD8);
+
+		for(int input = 0; input < 2; input++){
+			const int32_t* evenOutputs = &butterflyOutputs[2 * input * half + j];
+			const int32_t* oddOutputs  = evenOutputs + half;
+			__m256d evenBranch, oddBranch;
+			if(permuteBranches){
+				const int32_t* evenPermute = &butterflyPermutes[2 * (2 * input * half + j)];
+				const int32_t* oddPermute  = evenPermute + 2 * half;
+				evenBranch = _mm256_castps_pd(_mm256_permutevar8x32_ps(branches, _mm256_loadu_si256((const __m256i*)evenPermute)));
+				oddBranch  = _mm256_castps_pd(_mm256_permutevar8x32_ps(branches, _mm256_loadu_si256((const __m256i*)oddPermute)));
+			}
+			else{
+				evenBranch = _mm256_set_pd(bm[evenOutputs[3]], bm[evenOutputs[2]], bm[evenOutputs[1]], bm[evenOutputs[0]]);
+				oddBranch  = _mm256_set_pd(bm[oddOutputs[3]], bm[oddOutputs[2]], bm[oddOutputs[1]], bm[oddOutputs[0]]);
+			}
+			__m256d evenMetric = _mm256_add_pd(evenBranch, evenFathers);
+			__m256d oddMetric  = _mm256_add_pd(oddBranch, oddFathers);
+			_mm256_storeu_pd(nextPathMetrics + input * half + j, _mm256_min_pd(oddMetric, evenMetric));
+		}
+	}
+}
+
+template <int HALF>
+__attribute__((target("avx2")))
+void LowRateListDecoder::batchAcsStage_avx2(const double* prevPathMetrics, const double* stageBranchMetrics, double* nextPathMetrics){
+	int lanes = trellisLanes;
+	if(lanes % 4 != 0){
+		batchAcsStage_scalar<HALF>(prevPathMetrics, stageBranchMetrics, nextPathMetrics);
+		return;
+	}
+	const int half = HALF > 0 ? HALF : lowrate_numStates / 2;
+	for(int input = 0; input < 2; input++){
+		const int32_t* evenOutputs = &butterflyOutputs[2 * input * half];
+		const int32_t* oddOutputs  = evenOutputs + half;
+		for(int j = 0; j < half; j++){
+			const double* evenFathers = prevPathMetrics + 2 * j * lanes;
+			const double* oddFathers  = evenFathers + lanes;
+			const double* evenBranch  = stageBranchMetrics + evenOutputs[j] * lanes;
+			const double* oddBranch   = stageBranchMetrics + oddOutputs[j] * lanes;
+			double* next = nextPathMetrics + (input * half + j) * lanes;
+			for(int lane = 0; lane < lanes; lane += 4){
+				__m256d evenMetric = _mm256_add_pd(_mm256_loadu_pd(evenBranch + lane), _mm256_loadu_pd(evenFathers + lane));
+				__m256d oddMetric  = _mm256_add_pd(_mm256_loadu_pd(oddBranch + lane), _mm256_loadu_pd(oddFathers + lane));
+				_mm256_storeu_pd(next + lane, _mm256_min_pd(oddMetric, evenMetric));
+			}
+		}
+	}
+}
+
+#else
+
+// without x86 SIMD the vector kernels are never selected, they only forward to the scalar ones
+template <int HALF>
+void LowRateListDecoder::acsStage_sse41(const double* prevPathMetrics, const double* stageBranchMetrics, double* nextPathMetrics){
+	acsStage_scalar<HALF>(prevPathMetrics, stageBranchMetrics, nextPathMetrics);
+}
+
+template <int HALF>
+void LowRateListDecoder::acsStage_avx2(const double* prevPathMetrics, const double* stageBranchMetrics, double* nextPathMetrics){
+	acsStage_scalar<HALF>(prevPathMetrics, stageBranchMetrics, nextPathMetrics);
+}
+
+template <int HALF>
+void LowRateListDecoder::batchAcsStage_avx2(const double* prevPathMetrics, const double* stageBranchMetrics, double* nextPathMetrics){
+	batchAcsStage_scalar<HALF>(prevPathMetrics, stageBranchMetrics, nextPathMetrics);
+}
+
+#endif
@@ -8,65 +8,209 @@ LowRateListDecoder::LowRateListDecoder(FeedForwardTrellis feedforwardTrellis, in
 	this->lowrate_outputs       = feedforwardTrellis.getOutputs();
 	this->lowrate_numStates     = feedforwardTrellis.getNumStates();
 	this->lowrate_symbolLength  = feedforwardTrellis.getN();
+	this->lowrate_numOutputSymbols = feedforwardTrellis.getNumOutputSymbols();
 	this->numForwardPaths       = lowrate_nextStates[0].size();
   this->listSize              = listSize;
   this->crcDegree             = crcDegree;
   this->crc                   = crc;
 	this->stopping_rule					= stopping_rule;
 
-	if (this->stopping_rule != 'M' && this->stopping_rule != 'L') {
-		std::cerr << "[ERROR] INVALID STOPPING RULE" << std::endl;
-	}
+	// the stopping policy is resolved here, a decode calls its search directly
+	if (this->stopping_rule == 'L')
+		this->trellisSearch = &LowRateListDecoder::trellisSearch_MaxListsize;
+	else if (this->stopping_rule == 'M')
+		this->trellisSearch = &LowRateListDecoder::trellisSearch_MaxMetric;
+	else
+		throw std::invalid_argument("INVALID STOPPING RULE");
 	
 	int v = feedforwardTrellis.getV();
+
+	// the BPSK points only depend on the output symbol, so they are computed once here
+	// and each trellis stage only needs one branch metric per output symbol
+	this->lowrate_outputPoints = std::vector<double>(lowrate_numOutputSymbols * lowrate_symbolLength);
+	for(int output = 0; output < lowrate_numOutputSymbols; output++){
+		std::vector<int> output_point = crc::get_point(output, lowrate_symbolLength);
+		for(int i = 0; i < lowrate_symbolLength; i++)
+			lowrate_outputPoints[output * lowrate_symbolLength + i] = output_point[i];
+	}
+	this->workspace.branchMetrics = std::vector<double>(lowrate_numOutputSymbols);
+
+	// checks for the shift register structure the butterfly kernels rely on
+	int half = lowrate_numStates / 2;
+	this->butterflyTrellis = (numForwardPaths == 2 && lowrate_numStates >= 2);
+	for(int currentState = 0; butterflyTrellis && currentState < lowrate_numStates; currentState++){
+		for(int input = 0; input < numForwardPaths; input++){
+			if(lowrate_nextStates[currentState][input] != input * half + (currentState >> 1))
+				butterflyTrellis = false;
+		}
+	}
+	if(butterflyTrellis){
+		this->butterflyOutputs = std::vector<int32_t>(2 * lowrate_numStates);
+		for(int j = 0; j < half; j++){
+			butterflyOutputs[j]            = lowrate_outputs[2 * j][0];
+			butterflyOutputs[half + j]     = lowrate_outputs[2 * j + 1][0];
+			butterflyOutputs[2 * half + j] = lowrate_outputs[2 * j][1];
+			butterflyOutputs[3 * half + j] = lowrate_outputs[2 * j + 1][1];
+		}
+		this->butterflyPermutes = std::vector<int32_t>(2 * butterflyOutputs.size());
+		for(size_t i = 0; i < butterflyOutputs.size(); i++){
+			butterflyPermutes[2 * i]     = 2 * butterflyOutputs[i];
+			butterflyPermutes[2 * i + 1] = 2 * butterflyOutputs[i] + 1;
+		}
+	}
+	this->trellisLanes = 1;
+	this->trellisLane = 0;
+	this->branchLanes = 1;
+	this->multiTrellis = false;
+	this->laneOffset = 0;
+	this->laneSlots = std::vector<int>(lowrate_numStates, -1);
+	this->numLaneSlots = 0;
+	this->batchLanes = DECODE_BATCH_SIZE;
+	this->workspace.batchReceivedMessages = std::vector<const double*>(batchLanes);
+	this->workspace.detourTree.reserve(lowrate_numStates);
+	this->incrementalCrc = false;
+	this->inputBitShift = v - 1;
+	selectAcsKernel();
+}
+
+MessageInformation LowRateListDecoder::decode(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing) {
+	MessageInformation output;
+	decode(receivedMessage, puncturing, output);
+	return output;
 }
 
-MessageInformation LowRateListDecoder::decode(std::vector<double> receivedMessage, std::vector<int> punctured_indices) {
+void LowRateListDecoder::decode(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing, MessageInformation& result) {
 	/** Decode according to a policy passed into the constructor
 	 * 
 	 */
-	if (this->stopping_rule == 'L') {
-		// max listsize restriction
-		return lowRateDecoding_MaxListsize(receivedMessage, punctured_indices);
+	if (MULTI_TRELLIS && butterflyTrellis) {
+		// one trellis per starting state, only tail-biting paths are searched, see lowRateDecoding_MultiTrellis
+		constructLowRateMultiTrellis(receivedMessage, puncturing);
+	} else {
+		// max listsize or max metric restriction, both search the one trellis
+		constructLowRateTrellis_Punctured(receivedMessage, puncturing);
+	}
+	(this->*trellisSearch)(result);
+}
+
+std::vector<MessageInformation> LowRateListDecoder::decodeBatch(const std::vector<std::vector<double>>& receivedMessages, const PuncturingPattern& puncturing) {
+	std::vector<MessageInformation> outputs;
+	decodeBatch(receivedMessages, puncturing, outputs);
+	return outputs;
+}
 
-	} else if (this->stopping_rule == 'M') {
-		// max metric restriction
-		return lowRateDecoding_MaxMetric(receivedMessage, punctured_indices);
+void LowRateListDecoder::decodeBatch(const std::vector<std::vector<double>>& receivedMessages, const PuncturingPattern& puncturing, std::vector<MessageInformation>& results) {
+	/** Decodes independent received messages, in order, into results[frame]. Their trellises are built
+	 * DECODE_BATCH_SIZE at a time, one frame per SIMD lane, then each list search runs on its own trellis
+	 */
+	results.resize(receivedMessages.size());
+	if (!butterflyTrellis || MULTI_TRELLIS) {
+		for (size_t frame = 0; frame < receivedMessages.size(); frame++)
+			decode(receivedMessages[frame], puncturing, results[frame]);
+		return;
+	}
+
+	for (int firstFrame = 0; firstFrame < (int)receivedMessages.size(); firstFrame += batchLanes) {
+		int numFrames = std::min(batchLanes, (int)receivedMessages.size() - firstFrame);
+		constructLowRateTrellisBatch_Punctured(receivedMessages, firstFrame, numFrames, puncturing);
+		for (int lane = 0; lane < numFrames; lane++) {
+			trellisLane = lane;
+			(this->*trellisSearch)(results[firstFrame + lane]);
+		}
 	}
-	throw std::invalid_argument("INVALID DECODING CHOICE!");
 }
 
-MessageInformation LowRateListDecoder::lowRateDecoding_MaxListsize(std::vector<double> receivedMessage, std::vector<int> punctured_indices){
-	// trellisInfo is indexed [state][stage]
-	std::vector<std::vector<cell>> trellisInfo;
-	trellisInfo = constructLowRateTrellis_Punctured(receivedMessage, punctured_indices);
+MessageInformation LowRateListDecoder::lowRateDecoding_MultiTrellis(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing){
+	/** Searches one trellis per starting state, and only the tail-biting paths of each, in the
+	 * metric order of the single trellis search. every searched path is tail-biting, so listSize is
+	 * TBListSize, 'L' limits the number of tail-biting paths and 'M' searches the tail-biting paths
+	 * below MAX_METRIC and the first one at or above it. trellises without the shift register
+	 * structure fall back to the single trellis search
+	 */
+	MessageInformation output;
+	if(!butterflyTrellis)
+		constructLowRateTrellis_Punctured(receivedMessage, puncturing);
+	else
+		constructLowRateMultiTrellis(receivedMessage, puncturing);
+	(this->*trellisSearch)(output);
+	return output;
+}
 
-	// start search
+MessageInformation LowRateListDecoder::lowRateDecoding_MaxListsize(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing){
+	// builds the trellis into the decoder, the search reads it through trellisCell
+	MessageInformation output;
+	constructLowRateTrellis_Punctured(receivedMessage, puncturing);
+	trellisSearch_MaxListsize(output);
+	return output;
+}
+
+MessageInformation LowRateListDecoder::lowRateDecoding_MaxMetric(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing){
+	// builds the trellis into the decoder, the search reads it through trellisCell
 	MessageInformation output;
+	constructLowRateTrellis_Punctured(receivedMessage, puncturing);
+	trellisSearch_MaxMetric(output);
+	return output;
+}
+
+// list search over the trellis built last
+void LowRateListDecoder::trellisSearch_MaxListsize(MessageInformation& output){
+	NoObserver observer;
+	listSearch(MaxListsizeStop(this->listSize), observer, output);
+	trimWorkspace();
+}
+
+// list search over the trellis built last
+void LowRateListDecoder::trellisSearch_MaxMetric(MessageInformation& output){
+	NoObserver observer;
+	listSearch(MaxMetricStop(MAX_METRIC), observer, output);
+	trimWorkspace();
+}
+
+// the list search every decoding mode runs. the stopping policy decides when to give up and the
+// observer sees the candidates, both are resolved at compile time so the loop only carries the
+// work the mode needs. the result is written into output, which keeps its capacity
+template <typename StopPolicy, typename Observer>
+void LowRateListDecoder::listSearch(const StopPolicy& stop, Observer& observer, MessageInformation& output){
+	// start search
+	output.clear();
+	prepareSyndromeWeights();
+
+	// most frames decode on their best path, which needs neither the heap nor the path tree. an
+	// observer of every path takes the full search
+	if(!Observer::everyPath && stop.searching(0, 0.0) && decodeBestPath(output)){
+		observer.decoded(output);
+		return;
+	}
+
 	//RBTree detourTree;
-	MinHeap detourTree;
-	std::vector<std::vector<int>> previousPaths;
-	
+	workspace.detourTree.clear();
+	clearPathTree();
 
-	// create nodes for each valid ending state with no detours
+	// create nodes for each valid ending state with no detours. a multi trellis gets the bound of
+	// each lane instead, read off the single trellis, see popDetour
 	// std::cout<< "end path metrics:" <<std::endl;
+	laneOffset = 0;
 	for(int i = 0; i < lowrate_numStates; i++){
 		DetourObject detour;
+		detour.originalPathIndex = multiTrellis ? -2 : -1;
 		detour.startingState = i;
-		detour.pathMetric = trellisInfo[i][lowrate_pathLength - 1].pathMetric;
-		detourTree.insert(detour);
+		detour.setPathMetric(trellisPathMetric(i, lowrate_pathLength - 1));
+		workspace.detourTree.insert(detour);
 	}
 
 	int numPathsSearched = 0;
 	int TBPathsSearched = 0;
+	double currentMetricExplored = 0.0;
   
-	while(numPathsSearched < this->listSize){
-		DetourObject detour = detourTree.pop();
-		std::vector<int> path(lowrate_pathLength);
+	while(stop.searching(numPathsSearched, currentMetricExplored)){
+		DetourObject detour = popDetour();
+		if(multiTrellis)
+			selectLane(detour.startingState);
 
 		int newTracebackStage = lowrate_pathLength - 1;
 		double forwardPartialPathMetric = 0;
 		int currentState = detour.startingState;
+		uint32_t currentSyndrome = 0;
 
 		// if we are taking a detour from a previous path, we skip backwards to the point where we take the
 		// detour from the previous path
@@ -74,190 +218,361 @@ MessageInformation LowRateListDecoder::lowRateDecoding_MaxListsize(std::vector<d
 			forwardPartialPathMetric = detour.forwardPathMetric;
 			newTracebackStage = detour.detourStage;
 
-			// while we only need to copy the path from the detour to the end, this simplifies things,
-			// and we'll write over the earlier data in any case
-			path = previousPaths[detour.originalPathIndex];
-			currentState = path[newTracebackStage];
+			// the new path shares every stage from the detour to the end with the path it detours from,
+			// so only the stages before the detour are traced and stored
+			currentState = pathState(detour.originalPathIndex, newTracebackStage);
+			currentSyndrome = pathSyndrome(detour.originalPathIndex, newTracebackStage);
 
-			double suboptimalPathMetric = trellisInfo[currentState][newTracebackStage].suboptimalPathMetric;
+			cell detourCell = trellisCell(currentState, newTracebackStage);
+			double suboptimalPathMetric = detourCell.suboptimalPathMetric;
 
-			currentState = trellisInfo[currentState][newTracebackStage].suboptimalFatherState;
+			int detourState = currentState;
+			currentState = detourCell.suboptimalFatherState;
 			newTracebackStage--;
+			currentSyndrome ^= messageBitSyndrome(detourState, newTracebackStage);
 			
-			double prevPathMetric = trellisInfo[currentState][newTracebackStage].pathMetric;
+			double prevPathMetric = trellisPathMetric(currentState, newTracebackStage);
 
 			forwardPartialPathMetric += suboptimalPathMetric - prevPathMetric;
 			
 		}
-		path[newTracebackStage] = currentState;
+		int* newStates = addPath(detour.originalPathIndex, newTracebackStage + 1);
+		uint32_t* newSyndromes = pathSyndromes(numPathsSearched);
+		newStates[newTracebackStage] = currentState;
+		newSyndromes[newTracebackStage] = currentSyndrome;
+
+		// the detours of the new path, stages [1, newTracebackStage]. with lazy expansion only their
+		// best enters the heap, popDetour finds the others when it is popped
+		DetourObject pathDetours;
+		pathDetours.originalPathIndex = numPathsSearched;
+		pathDetours.startingState = detour.startingState;
+		pathDetours.firstStage = 1;
+		pathDetours.lastStage = newTracebackStage;
+		pathDetours.forwardPathMetric = forwardPartialPathMetric;
+		pathDetours.detourStage = -1;
 
 		// actually tracing back
 		for(int stage = newTracebackStage; stage > 0; stage--){
-			double suboptimalPathMetric = trellisInfo[currentState][stage].suboptimalPathMetric;
-			double currPathMetric = trellisInfo[currentState][stage].pathMetric;
+			cell currentCell = trellisCell(currentState, stage);
+			double suboptimalPathMetric = currentCell.suboptimalPathMetric;
+			double currPathMetric = currentCell.pathMetric;
 
 			// if there is a detour we add to the detourTree
-			if(trellisInfo[currentState][stage].suboptimalFatherState != -1){
-				DetourObject localDetour;
-				localDetour.detourStage = stage;
-				localDetour.originalPathIndex = numPathsSearched;
-				localDetour.pathMetric = suboptimalPathMetric + forwardPartialPathMetric;
-				localDetour.forwardPathMetric = forwardPartialPathMetric;
-				localDetour.startingState = detour.startingState;
-				detourTree.insert(localDetour);
+			if(currentCell.suboptimalFatherState != -1){
+				uint64_t metricKey = packMetric(suboptimalPathMetric + forwardPartialPathMetric);
+				if(!LAZY_DETOUR_EXPANSION){
+					DetourObject localDetour = pathDetours;
+					localDetour.metricKey = metricKey;
+					localDetour.detourStage = localDetour.firstStage = localDetour.lastStage = stage;
+					localDetour.forwardPathMetric = forwardPartialPathMetric;
+					workspace.detourTree.insert(localDetour);
+				}
+				else if(pathDetours.detourStage == -1 || metricKey < pathDetours.metricKey){
+					// on equal metrics the later stage stays, as in the detour order
+					pathDetours.metricKey = metricKey;
+					pathDetours.detourStage = stage;
+				}
 			}
-			currentState = trellisInfo[currentState][stage].optimalFatherState;
-			double prevPathMetric = trellisInfo[currentState][stage - 1].pathMetric;
+			int childState = currentState;
+			currentState = currentCell.optimalFatherState;
+			double prevPathMetric = trellisPathMetric(currentState, stage - 1);
 			forwardPartialPathMetric += currPathMetric - prevPathMetric;
-			path[stage - 1] = currentState;
+			newStates[stage - 1] = currentState;
+			newSyndromes[stage - 1] = newSyndromes[stage] ^ messageBitSyndrome(childState, stage - 1);
+		} // for(int stage = newTracebackStage; stage > 0; stage--)
+		if(LAZY_DETOUR_EXPANSION && pathDetours.detourStage != -1)
+			workspace.detourTree.insert(pathDetours);
+
+
+		// every path ends in its starting state and traces its own first stage, so the tail-biting
+		// check needs no full path. the crc syndrome of the whole message is the one at stage 0, so
+		// with incremental crc only the decoded path is materialized
+		bool tailBiting = newStates[0] == detour.startingState;
+		currentMetricExplored = forwardPartialPathMetric;
+
+		// only observers that look at every candidate pay for materializing it
+		if(Observer::everyPath){
+			materializePath(numPathsSearched, workspace.candidatePath);
+			observer.candidate(workspace.candidatePath, output);
 		}
-		
-		previousPaths.push_back(path);
 
-		std::vector<int> message = pathToMessage(path);
-		std::vector<int> codeword = pathToCodeword(path);
-		
 		// one trellis decoding requires both a tb and crc check
-		if(path[0] == path[lowrate_pathLength - 1] && crc::crc_check(message, crcDegree, crc)){
-			output.message = message;
-			output.path = path;
-		 	output.listSize = numPathsSearched + 1;
-			output.metric = forwardPartialPathMetric;
-			output.TBListSize = TBPathsSearched + 1;
-		 	return output;
+		if(tailBiting && (!incrementalCrc || newSyndromes[0] == 0)){
+			materializePath(numPathsSearched, workspace.candidatePath);
+			pathToMessage(workspace.candidatePath, workspace.candidateMessage);
+			if(incrementalCrc || crc::crc_check(workspace.candidateMessage, crcDegree, crc)){
+				output.message = workspace.candidateMessage;
+				output.path = workspace.candidatePath;
+				output.listSize = numPathsSearched + 1;
+				output.metric = forwardPartialPathMetric;
+				output.TBListSize = TBPathsSearched + 1;
+				observer.decoded(output);
+				return;
+			}
 		}
 
 		numPathsSearched++;
-		if(path[0] == path[lowrate_pathLength - 1])
+		if(tailBiting)
 			TBPathsSearched++;
-	} // while(numPathsSearched < this->listSize)
+	} // while(stop.searching(numPathsSearched, currentMetricExplored))
 
 	output.listSizeExceeded = true;
-	return output;
+	observer.exceeded(output, numPathsSearched, currentMetricExplored);
+	// std::cerr << "[WARNING]: TC IS NOT FOUND!!! " << std::endl;
 }
 
 
-
-MessageInformation LowRateListDecoder::lowRateDecoding_MaxMetric(std::vector<double> receivedMessage, std::vector<int> punctured_indices){
-	// trellisInfo is indexed [state][stage]
-	std::vector<std::vector<cell>> trellisInfo;
-	trellisInfo = constructLowRateTrellis_Punctured(receivedMessage, punctured_indices);
-
-	// start search
-	MessageInformation output;
-	//RBTree detourTree;
-	MinHeap detourTree;
-	std::vector<std::vector<int>> previousPaths;
-	
-
-	// create nodes for each valid ending state with no detours
-	// std::cout<< "end path metrics:" <<std::endl;
-	for(int i = 0; i < lowrate_numStates; i++){
-		DetourObject detour;
-		detour.startingState = i;
-		detour.pathMetric = trellisInfo[i][lowrate_pathLength - 1].pathMetric;
-		detourTree.insert(detour);
+// traces the best path straight into candidatePath, with no detours and no path tree, and decodes
+// it at list size 1 if it is tail-biting and passes the crc. the best ending state is the first
+// with the smallest metric, the one the heap would pop first, and the metric adds up in the same
+// order as in listSearch, so a decoded frame is exactly what the full search returns. a frame that
+// fails starts the full search over, which retraces this path and queues its detours.
+// a multi trellis runs this on its single trellis: no tail-biting path beats the best path, and
+// the lane of its starting state has the same survivors along it, so when the best path is
+// tail-biting it is also the path the lane search pops first
+bool LowRateListDecoder::decodeBestPath(MessageInformation& output){
+	int endStage = lowrate_pathLength - 1;
+	int bestState = 0;
+	laneOffset = 0;
+	double bestMetric = trellisPathMetric(0, endStage);
+	for(int i = 1; i < lowrate_numStates; i++){
+		double metric = trellisPathMetric(i, endStage);
+		if(metric < bestMetric){
+			bestState = i;
+			bestMetric = metric;
+		}
 	}
 
-	int numPathsSearched = 0;
-	int TBPathsSearched = 0;
-	double currentMetricExplored = 0.0;
-  
-	while(currentMetricExplored < MAX_METRIC){
-		DetourObject detour = detourTree.pop();
-		std::vector<int> path(lowrate_pathLength);
-
-		int newTracebackStage = lowrate_pathLength - 1;
-		double forwardPartialPathMetric = 0;
-		int currentState = detour.startingState;
+	std::vector<int>& path = workspace.candidatePath;
+	path.resize(lowrate_pathLength);
+	int currentState = bestState;
+	uint32_t syndrome = 0;
+	double forwardPartialPathMetric = 0;
+	path[endStage] = currentState;
+	for(int stage = endStage; stage > 0; stage--){
+		cell currentCell = trellisCell(currentState, stage);
+		int childState = currentState;
+		currentState = currentCell.optimalFatherState;
+		forwardPartialPathMetric += currentCell.pathMetric - trellisPathMetric(currentState, stage - 1);
+		path[stage - 1] = currentState;
+		syndrome ^= messageBitSyndrome(childState, stage - 1);
+	}
 
-		// if we are taking a detour from a previous path, we skip backwards to the point where we take the
-		// detour from the previous path
-		if(detour.originalPathIndex != -1){
-			forwardPartialPathMetric = detour.forwardPathMetric;
-			newTracebackStage = detour.detourStage;
+	if(path[0] != bestState || (incrementalCrc && syndrome != 0))
+		return false;
+	pathToMessage(path, workspace.candidateMessage);
+	if(!incrementalCrc && !crc::crc_check(workspace.candidateMessage, crcDegree, crc))
+		return false;
+
+	output.message = workspace.candidateMessage;
+	output.path = path;
+	output.listSize = 1;
+	output.metric = forwardPartialPathMetric;
+	output.TBListSize = 1;
+	return true;
+}
 
-			// while we only need to copy the path from the detour to the end, this simplifies things,
-			// and we'll write over the earlier data in any case
-			path = previousPaths[detour.originalPathIndex];
-			currentState = path[newTracebackStage];
+// the MLA search instantiates the kernel from mla.cpp
+template void LowRateListDecoder::listSearch(const MaxListsizeStop& stop, MlaObserver& observer, MessageInformation& output);
+
+// gives back the search storage after a search that went past WORKSPACE_RETAIN_PATHS paths. the
+// rare deep frames then allocate their own, and a decoder, one per thread, only keeps what the
+// typical frame needs
+void LowRateListDecoder::trimWorkspace(){
+	if((int)workspace.pathTree.capacity() <= WORKSPACE_RETAIN_PATHS)
+		return;
+	workspace.detourTree.release();
+	std::vector<pathNode>().swap(workspace.pathTree);
+	std::vector<int>().swap(workspace.pathTreeStates);
+	std::vector<uint32_t>().swap(workspace.pathTreeSyndromes);
+}
 
-			double suboptimalPathMetric = trellisInfo[currentState][newTracebackStage].suboptimalPathMetric;
+void LowRateListDecoder::clearPathTree(){
+	workspace.pathTree.clear();
+	workspace.pathTreeStates.clear();
+	workspace.pathTreeSyndromes.clear();
+}
 
-			currentState = trellisInfo[currentState][newTracebackStage].suboptimalFatherState;
-			newTracebackStage--;
-			
-			double prevPathMetric = trellisInfo[currentState][newTracebackStage].pathMetric;
+// appends a path that traces the stages [0, numNewStates) itself and shares the later stages with
+// parentPath, and returns where its traced states go. the pointer is valid until the next addPath
+int* LowRateListDecoder::addPath(int parentPath, int numNewStates){
+	pathNode node;
+	node.parentPath = parentPath;
+	node.numNewStates = numNewStates;
+	node.offset = workspace.pathTreeStates.size();
+	workspace.pathTree.push_back(node);
+	workspace.pathTreeStates.resize(node.offset + numNewStates);
+	workspace.pathTreeSyndromes.resize(node.offset + numNewStates);
+	return &workspace.pathTreeStates[node.offset];
+}
 
-			forwardPartialPathMetric += suboptimalPathMetric - prevPathMetric;
-			
+// pops the detour with the smallest metric. a lazy detour stands for a range of stages of its path
+// and carries the best detour among them. popping it walks the range down again, the way listSearch
+// traced it, which rebuilds the forward metric of the popped detour and finds the best detours above
+// and below it. those two go back into the heap, so it holds at most two ranges per popped path
+// besides the ending states, and no detour is stored outside the heap.
+// the bound of a multi trellis lane is expanded the same way: popping it builds the lane and roots
+// its tail-biting path, whose metric is at least the bound, so the heap order stays exact
+DetourObject LowRateListDecoder::popDetour(){
+	DetourObject detour = workspace.detourTree.pop();
+	while(detour.originalPathIndex == -2){
+		buildLane(detour.startingState);
+		double metric = trellisPathMetric(detour.startingState, lowrate_pathLength - 1);
+		if(metric != std::numeric_limits<double>::infinity()){
+			detour.originalPathIndex = -1;
+			detour.setPathMetric(metric);
+			workspace.detourTree.insert(detour);
 		}
-		path[newTracebackStage] = currentState;
-
-		// actually tracing back
-		for(int stage = newTracebackStage; stage > 0; stage--){
-			double suboptimalPathMetric = trellisInfo[currentState][stage].suboptimalPathMetric;
-			double currPathMetric = trellisInfo[currentState][stage].pathMetric;
-
-			// if there is a detour we add to the detourTree
-			if(trellisInfo[currentState][stage].suboptimalFatherState != -1){
-				DetourObject localDetour;
-				localDetour.detourStage = stage;
-				localDetour.originalPathIndex = numPathsSearched;
-				localDetour.pathMetric = suboptimalPathMetric + forwardPartialPathMetric;
-				localDetour.forwardPathMetric = forwardPartialPathMetric;
-				localDetour.startingState = detour.startingState;
-				detourTree.insert(localDetour);
+		detour = workspace.detourTree.pop();
+	}
+	if(detour.originalPathIndex == -1)
+		return detour;
+	if(detour.firstStage == detour.lastStage)
+		return detour;
+	if(multiTrellis)
+		selectLane(detour.startingState);
+
+	DetourObject upper = detour;
+	upper.firstStage = detour.detourStage + 1;
+	upper.detourStage = -1;
+	DetourObject lower = detour;
+	lower.lastStage = detour.detourStage - 1;
+	lower.detourStage = -1;
+
+	const int* states = &workspace.pathTreeStates[workspace.pathTree[detour.originalPathIndex].offset];
+	double forwardPartialPathMetric = detour.forwardPathMetric;
+	for(int stage = detour.lastStage; stage >= detour.firstStage; stage--){
+		cell currentCell = trellisCell(states[stage], stage);
+		if(stage == detour.detourStage){
+			detour.forwardPathMetric = forwardPartialPathMetric;
+		}
+		else if(currentCell.suboptimalFatherState != -1){
+			DetourObject& side = stage > detour.detourStage ? upper : lower;
+			uint64_t metricKey = packMetric(currentCell.suboptimalPathMetric + forwardPartialPathMetric);
+			if(side.detourStage == -1 || metricKey < side.metricKey){
+				side.metricKey = metricKey;
+				side.detourStage = stage;
 			}
-			currentState = trellisInfo[currentState][stage].optimalFatherState;
-			double prevPathMetric = trellisInfo[currentState][stage - 1].pathMetric;
-			forwardPartialPathMetric += currPathMetric - prevPathMetric;
-			path[stage - 1] = currentState;
-		} // for(int stage = newTracebackStage; stage > 0; stage--)
-		
-		previousPaths.push_back(path);
-
-		std::vector<int> message = pathToMessage(path);
-		std::vector<int> codeword = pathToCodeword(path);
-		currentMetricExplored = forwardPartialPathMetric;
-		
-		// one trellis decoding requires both a tb and crc check
-		if(path[0] == path[lowrate_pathLength - 1] && crc::crc_check(message, crcDegree, crc)){
-			output.message = message;
-			output.path = path;
-		 	output.listSize = numPathsSearched + 1;
-			output.metric = forwardPartialPathMetric;
-			output.TBListSize = TBPathsSearched + 1;
-		 	return output;
 		}
+		forwardPartialPathMetric += currentCell.pathMetric - trellisPathMetric(states[stage - 1], stage - 1);
+		if(stage == detour.detourStage)
+			lower.forwardPathMetric = forwardPartialPathMetric;
+	}
+	if(upper.detourStage != -1)
+		workspace.detourTree.insert(upper);
+	if(lower.detourStage != -1)
+		workspace.detourTree.insert(lower);
+	return detour;
+}
 
-		numPathsSearched++;
-		if(path[0] == path[lowrate_pathLength - 1])
-			TBPathsSearched++;
-	} // while(currentMetricExplored < MAX_METRIC)
+// state of a searched path at one stage, found in the first ancestor that traced that stage
+int LowRateListDecoder::pathState(int pathIndex, int stage) const {
+	while(stage >= workspace.pathTree[pathIndex].numNewStates)
+		pathIndex = workspace.pathTree[pathIndex].parentPath;
+	return workspace.pathTreeStates[workspace.pathTree[pathIndex].offset + stage];
+}
 
-	output.listSizeExceeded = true;
-	// std::cerr << "[WARNING]: TC IS NOT FOUND!!! " << std::endl;
-	return output;
+// crc syndrome of the message bits from one stage to the end of a searched path. like its state,
+// it is stored by the first ancestor that traced that stage
+uint32_t LowRateListDecoder::pathSyndrome(int pathIndex, int stage) const {
+	while(stage >= workspace.pathTree[pathIndex].numNewStates)
+		pathIndex = workspace.pathTree[pathIndex].parentPath;
+	return workspace.pathTreeSyndromes[workspace.pathTree[pathIndex].offset + stage];
 }
 
-std::vector<std::vector<LowRateListDecoder::cell>> LowRateListDecoder::constructLowRateTrellis(std::vector<double> receivedMessage){
-	std::vector<std::vector<cell>> trellisInfo;
-	lowrate_pathLength = (receivedMessage.size() / lowrate_symbolLength) + 1;
+// the crc is linear, so the syndrome of a message is the sum of the syndromes of its set bits, and a
+// path's syndrome can be accumulated stage by stage while tracing. the weights are rebuilt only when
+// the path length changes. trellises that are not a shift register, or a crc the engine does not
+// divide like the bitwise check, keep checking the materialized message instead
+void LowRateListDecoder::prepareSyndromeWeights(){
+	int messageLength = lowrate_pathLength - 1;
+	if((int)syndromeWeights.size() == messageLength)
+		return;
+	const crc::Engine& crcEngine = crc::engine(crcDegree, crc);
+	incrementalCrc = butterflyTrellis && crcDegree - 1 <= 32 && crcEngine.supports(messageLength);
+	syndromeWeights = std::vector<uint32_t>(messageLength, 0);
+	if(incrementalCrc){
+		std::vector<uint64_t> weights = crcEngine.bitWeights(messageLength);
+		for(int i = 0; i < messageLength; i++)
+			syndromeWeights[i] = (uint32_t)weights[i];
+	}
+}
 
-	trellisInfo = std::vector<std::vector<cell>>(lowrate_numStates, std::vector<cell>(lowrate_pathLength));
+// copies a searched path out of the tree into path, one ancestor segment at a time
+void LowRateListDecoder::materializePath(int pathIndex, std::vector<int>& path) const {
+	path.resize(lowrate_pathLength);
+	int filledStages = 0;
+	while(filledStages < lowrate_pathLength){
+		const pathNode& node = workspace.pathTree[pathIndex];
+		for(int stage = filledStages; stage < node.numNewStates; stage++)
+			path[stage] = workspace.pathTreeStates[node.offset + stage];
+		filledStages = std::max(filledStages, node.numNewStates);
+		pathIndex = node.parentPath;
+	}
+}
+
+// sizes the trellis arena for the current path length and resets its cells. the arena only
+// reallocates when the path length changes, so repeated decodes of one code reuse the buffer
+void LowRateListDecoder::resetTrellis(){
+	workspace.trellisInfo.resize(lowrate_pathLength * lowrate_numStates);
+	std::fill(workspace.trellisInfo.begin(), workspace.trellisInfo.end(), cell());
 
 	// initializes all the valid starting states
 	for(int i = 0; i < lowrate_numStates; i++){
-		trellisInfo[i][0].pathMetric = 0;
-		trellisInfo[i][0].init = true;
+		workspace.trellisInfo[i].pathMetric = 0;
+		workspace.trellisInfo[i].init = true;
 	}
+}
+
+void LowRateListDecoder::constructLowRateTrellis(const std::vector<double>& receivedMessage){
+	// an unpunctured trellis is a punctured one where every symbol is kept
+	constructLowRateTrellis_Punctured(receivedMessage, PuncturingPattern(std::vector<int>(), receivedMessage.size()));
+}
+
+void LowRateListDecoder::constructLowRateTrellis_Punctured(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing){
+	/* Constructs a trellis for a low rate code, with puncturing
+		Args:
+			receivedMessage (std::vector<double>): the received message
+			puncturing (PuncturingPattern): the puncturing pattern of the received message
+
+		Result:
+			the trellis is stored in the decoder, the searches read it through trellisCell
+	*/
+
+	/* ---- Code Begins ---- */
+	if(puncturing.length() != (int)receivedMessage.size())
+		throw std::invalid_argument("Puncturing pattern does not match the received message");
+	const double* puncturingWeights = puncturing.weights.data();
+
+	lowrate_pathLength = (receivedMessage.size() / lowrate_symbolLength) + 1;
+	multiTrellis = false;
+	if(butterflyTrellis){
+		const double* receivedMessages[1] = {receivedMessage.data()};
+		constructButterflyTrellis(receivedMessages, 1, puncturingWeights);
+		trellisLane = 0;
+		return;
+	}
+	resetTrellis();
 	
 	// building the trellis
 	for(int stage = 0; stage < lowrate_pathLength - 1; stage++){
+		cell* currentRow = &workspace.trellisInfo[stage * lowrate_numStates];
+		cell* nextRow = currentRow + lowrate_numStates;
+		// branch metric of every output symbol at this stage
+		for(int output = 0; output < lowrate_numOutputSymbols; output++){
+			const double* output_point = &lowrate_outputPoints[output * lowrate_symbolLength];
+			double branchMetric = 0;
+			for(int i = 0; i < lowrate_symbolLength; i++){
+				// punctured symbols have zero weight and add nothing to the metric
+				double diff = receivedMessage[lowrate_symbolLength * stage + i] - output_point[i];
+				branchMetric += puncturingWeights[lowrate_symbolLength * stage + i] * diff * diff;
+			}
+			workspace.branchMetrics[output] = branchMetric;
+		}
+
 		for(int currentState = 0; currentState < lowrate_numStates; currentState++){
 			// if the state / stage is invalid, we move on
-			if(!trellisInfo[currentState][stage].init)
+			if(!currentRow[currentState].init)
 				continue;
 
 			// otherwise, we compute the relevent information
@@ -271,130 +586,148 @@ std::vector<std::vector<LowRateListDecoder::cell>> LowRateListDecoder::construct
 				if(nextState < 0)
 					continue;
 				
-				double branchMetric = 0;
-				std::vector<int> output_point = crc::get_point(lowrate_outputs[currentState][forwardPathIndex], lowrate_symbolLength);
-				
-				for(int i = 0; i < lowrate_symbolLength; i++){
-					branchMetric += std::pow(receivedMessage[lowrate_symbolLength * stage + i] - (double)output_point[i], 2);
-					// branchMetric += std::abs(receivedMessage[lowrate_symbolLength * stage + i] - (double)output_point[i]);
-				}
-				double totalPathMetric = branchMetric + trellisInfo[currentState][stage].pathMetric;
+				double totalPathMetric = workspace.branchMetrics[lowrate_outputs[currentState][forwardPathIndex]] + currentRow[currentState].pathMetric;
 				
 				// dealing with cases of uninitialized states, when the transition becomes the optimal father state, and suboptimal father state, in order
-				if(!trellisInfo[nextState][stage + 1].init){
-					trellisInfo[nextState][stage + 1].pathMetric = totalPathMetric;
-					trellisInfo[nextState][stage + 1].optimalFatherState = currentState;
-					trellisInfo[nextState][stage + 1].init = true;
+				cell& next = nextRow[nextState];
+				if(!next.init){
+					next.pathMetric = totalPathMetric;
+					next.optimalFatherState = currentState;
+					next.init = true;
 				}
-				else if(trellisInfo[nextState][stage + 1].pathMetric > totalPathMetric){
-					trellisInfo[nextState][stage + 1].suboptimalPathMetric = trellisInfo[nextState][stage + 1].pathMetric;
-					trellisInfo[nextState][stage + 1].suboptimalFatherState = trellisInfo[nextState][stage + 1].optimalFatherState;
-					trellisInfo[nextState][stage + 1].pathMetric = totalPathMetric;
-					trellisInfo[nextState][stage + 1].optimalFatherState = currentState;
+				else if(next.pathMetric > totalPathMetric){
+					next.suboptimalPathMetric = next.pathMetric;
+					next.suboptimalFatherState = next.optimalFatherState;
+					next.pathMetric = totalPathMetric;
+					next.optimalFatherState = currentState;
 				}
 				else{
-					trellisInfo[nextState][stage + 1].suboptimalPathMetric = totalPathMetric;
-					trellisInfo[nextState][stage + 1].suboptimalFatherState = currentState;
+					next.suboptimalPathMetric = totalPathMetric;
+					next.suboptimalFatherState = currentState;
 				}
 			}
 
 		}
 	}
-	return trellisInfo;
 }
 
-std::vector<std::vector<LowRateListDecoder::cell>> LowRateListDecoder::constructLowRateTrellis_Punctured(std::vector<double> receivedMessage, std::vector<int> punctured_indices){
-	/* Constructs a trellis for a low rate code, with puncturing
+void LowRateListDecoder::constructLowRateTrellisBatch_Punctured(const std::vector<std::vector<double>>& receivedMessages, int firstFrame, int numFrames, const PuncturingPattern& puncturing){
+	/* Constructs the butterfly trellises of up to batchLanes received messages at once, with puncturing
 		Args:
-			receivedMessage (std::vector<double>): the received message
-			punctured_indices (std::vector<int>): the indices of the punctured bits
+			receivedMessages (std::vector<std::vector<double>>): the received messages
+			firstFrame (int): index of the message that goes into lane 0
+			numFrames (int): number of lanes in use, the remaining lanes see an all zero message
+			puncturing (PuncturingPattern): the puncturing pattern shared by the received messages
 
-		Returns:
-			std::vector<std::vector<cell>>: the trellis
+		Result:
+			the trellises are stored side by side, set trellisLane to choose the one trellisCell reads
 	*/
 
 	/* ---- Code Begins ---- */
-	std::vector<std::vector<cell>> trellisInfo;
-	lowrate_pathLength = (receivedMessage.size() / lowrate_symbolLength) + 1;
+	for(int lane = 0; lane < batchLanes; lane++){
+		workspace.batchReceivedMessages[lane] = nullptr;
+		if(lane >= numFrames)
+			continue;
+		if(puncturing.length() != (int)receivedMessages[firstFrame + lane].size())
+			throw std::invalid_argument("Puncturing pattern does not match the received message");
+		workspace.batchReceivedMessages[lane] = receivedMessages[firstFrame + lane].data();
+	}
 
-	trellisInfo = std::vector<std::vector<cell>>(lowrate_numStates, std::vector<cell>(lowrate_pathLength));
+	lowrate_pathLength = (puncturing.length() / lowrate_symbolLength) + 1;
+	multiTrellis = false;
+	constructButterflyTrellis(workspace.batchReceivedMessages.data(), batchLanes, puncturing.weights.data());
+}
 
-	// initializes all the valid starting states
-	for(int i = 0; i < lowrate_numStates; i++){
-		trellisInfo[i][0].pathMetric = 0;
-		trellisInfo[i][0].init = true;
-	}
-	
-	// building the trellis
+void LowRateListDecoder::constructLowRateMultiTrellis(const std::vector<double>& receivedMessage, const PuncturingPattern& puncturing){
+	/* Constructs the single trellis of a multi trellis, with puncturing
+		Args:
+			receivedMessage (std::vector<double>): the received message
+			puncturing (PuncturingPattern): the puncturing pattern of the received message
+
+		Result:
+			the single trellis is slot 0 of the path metric array, the lanes are built by the
+			search when it reaches them, see buildLane
+	*/
+
+	/* ---- Code Begins ---- */
+	constructLowRateTrellis_Punctured(receivedMessage, puncturing);
+	multiTrellis = true;
+	std::fill(laneSlots.begin(), laneSlots.end(), -1);
+	numLaneSlots = 1;
+}
+
+// builds the trellis of one starting state into the next free slot, on the branch metrics of the
+// single trellis. the storage only grows, up to the single trellis and numStates lanes, so a decoder
+// keeps the storage of the most lanes a frame built
+void LowRateListDecoder::buildLane(int lane){
+	int laneSize = lowrate_pathLength * lowrate_numStates;
+	laneSlots[lane] = numLaneSlots++;
+	if(workspace.trellisPathMetrics.size() < (size_t)numLaneSlots * laneSize)
+		workspace.trellisPathMetrics.resize((size_t)numLaneSlots * laneSize);
+	selectLane(lane);
+
+	// the lane only starts from its own state, the other states are unreachable
+	double* pathMetrics = &workspace.trellisPathMetrics[laneOffset];
+	std::fill(pathMetrics, pathMetrics + lowrate_numStates, std::numeric_limits<double>::infinity());
+	pathMetrics[lane] = 0;
 	for(int stage = 0; stage < lowrate_pathLength - 1; stage++){
-		for(int currentState = 0; currentState < lowrate_numStates; currentState++){
-			// if the state / stage is invalid, we move on
-			if(!trellisInfo[currentState][stage].init)
-				continue;
+		const double* stageBranchMetrics = &workspace.trellisBranchMetrics[stage * lowrate_numOutputSymbols];
+		(this->*acsStage)(pathMetrics + stage * lowrate_numStates, stageBranchMetrics, pathMetrics + (stage + 1) * lowrate_numStates);
+	}
+}
 
-			// otherwise, we compute the relevent information
-			for(int forwardPathIndex = 0; forwardPathIndex < numForwardPaths; forwardPathIndex++){
-				// since our transitions correspond to symbols, the forwardPathIndex has no correlation 
-				// beyond indexing the forward path
+// fills the path and branch metric arrays of a butterfly trellis for `lanes` frames. a null
+// received message leaves its lane at zero metrics
+void LowRateListDecoder::constructButterflyTrellis(const double* const* receivedMessages, int lanes, const double* puncturingWeights){
+	trellisLanes = lanes;
+	branchLanes = lanes;
+	workspace.trellisPathMetrics.resize(lowrate_pathLength * lowrate_numStates * lanes);
+	workspace.trellisBranchMetrics.resize((lowrate_pathLength - 1) * lowrate_numOutputSymbols * lanes);
 
-				int nextState = lowrate_nextStates[currentState][forwardPathIndex];
-				
-				// if the nextState is invalid, we move on
-				if(nextState < 0)
-					continue;
-				
+	// every state is a valid starting state
+	std::fill(workspace.trellisPathMetrics.begin(), workspace.trellisPathMetrics.begin() + lowrate_numStates * lanes, 0.0);
+
+	for(int stage = 0; stage < lowrate_pathLength - 1; stage++){
+		// branch metric of every output symbol at this stage, for every lane
+		double* stageBranchMetrics = &workspace.trellisBranchMetrics[stage * lowrate_numOutputSymbols * lanes];
+		for(int output = 0; output < lowrate_numOutputSymbols; output++){
+			const double* output_point = &lowrate_outputPoints[output * lowrate_symbolLength];
+			for(int lane = 0; lane < lanes; lane++){
 				double branchMetric = 0;
-				std::vector<int> output_point = crc::get_point(lowrate_outputs[currentState][forwardPathIndex], lowrate_symbolLength);
-				
-				for(int i = 0; i < lowrate_symbolLength; i++){
-					if (std::find(punctured_indices.begin(), punctured_indices.end(), lowrate_symbolLength * stage + i) != punctured_indices.end()){
-						branchMetric += 0;
-					} else {
-						branchMetric += std::pow(receivedMessage[lowrate_symbolLength * stage + i] - (double)output_point[i], 2);
+				if(receivedMessages[lane] != nullptr){
+					for(int i = 0; i < lowrate_symbolLength; i++){
+						// punctured symbols have zero weight and add nothing to the metric
+						double diff = receivedMessages[lane][lowrate_symbolLength * stage + i] - output_point[i];
+						branchMetric += puncturingWeights[lowrate_symbolLength * stage + i] * diff * diff;
 					}
 				}
-				
-				double totalPathMetric = branchMetric + trellisInfo[currentState][stage].pathMetric;
-				
-				// dealing with cases of uninitialized states, when the transition becomes the optimal father state, and suboptimal father state, in order
-				if(!trellisInfo[nextState][stage + 1].init){
-					trellisInfo[nextState][stage + 1].pathMetric = totalPathMetric;
-					trellisInfo[nextState][stage + 1].optimalFatherState = currentState;
-					trellisInfo[nextState][stage + 1].init = true;
-				}
-				else if(trellisInfo[nextState][stage + 1].pathMetric > totalPathMetric){
-					trellisInfo[nextState][stage + 1].suboptimalPathMetric = trellisInfo[nextState][stage + 1].pathMetric;
-					trellisInfo[nextState][stage + 1].suboptimalFatherState = trellisInfo[nextState][stage + 1].optimalFatherState;
-					trellisInfo[nextState][stage + 1].pathMetric = totalPathMetric;
-					trellisInfo[nextState][stage + 1].optimalFatherState = currentState;
-				}
-				else{
-					trellisInfo[nextState][stage + 1].suboptimalPathMetric = totalPathMetric;
-					trellisInfo[nextState][stage + 1].suboptimalFatherState = currentState;
-				}
+				stageBranchMetrics[output * lanes + lane] = branchMetric;
 			}
-
 		}
+
+		const double* prevPathMetrics = &workspace.trellisPathMetrics[stage * lowrate_numStates * lanes];
+		double* nextPathMetrics = &workspace.trellisPathMetrics[(stage + 1) * lowrate_numStates * lanes];
+		if(lanes == 1)
+			(this->*acsStage)(prevPathMetrics, stageBranchMetrics, nextPathMetrics);
+		else
+			(this->*batchAcsStage)(prevPathMetrics, stageBranchMetrics, nextPathMetrics);
 	}
-	return trellisInfo;
 }
 
-
-// converts a path through the tb trellis to the binary message it corresponds with
-std::vector<int> LowRateListDecoder::pathToMessage(std::vector<int> path){
-	std::vector<int> message;
+// converts a path through the tb trellis to the binary message it corresponds with, into message
+void LowRateListDecoder::pathToMessage(const std::vector<int>& path, BitVector& message) const {
+	message.reset(path.size() - 1);
 	for(int pathIndex = 0; pathIndex < path.size() - 1; pathIndex++){
-		for(int forwardPath = 0; forwardPath < numForwardPaths; forwardPath++){
+		for(int forwardPath = 1; forwardPath < numForwardPaths; forwardPath++){
 			if(lowrate_nextStates[path[pathIndex]][forwardPath] == path[pathIndex + 1])
-				message.push_back(forwardPath);
+				message.set(pathIndex, forwardPath);
 		}
 	}
-	return message;
 }
 
 // converts a path through the tb trellis to the BPSK it corresponds with
 // currently does NOT puncture the codeword
-std::vector<int> LowRateListDecoder::pathToCodeword(std::vector<int> path){
+std::vector<int> LowRateListDecoder::pathToCodeword(const std::vector<int>& path) const {
 	std::vector<int> nopunc_codeword;
 	for(int pathIndex = 0; pathIndex < path.size() - 1; pathIndex++){
 		for(int forwardPath = 0; forwardPath < numForwardPaths; forwardPath++){
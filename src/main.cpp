@@ -6,6 +6,9 @@
 #include <numeric>
 #include <string>
 #include <sstream>
+#include <atomic>
+#include <thread>
+#include <memory>
 #include "/opt/homebrew/Cellar/open-mpi/5.0.7/include/mpi.h"
 // #include "mpi.h"
 
@@ -14,19 +17,105 @@
 #include "../include/mla_namespace.h"
 #include "../include/feedForwardTrellis.h"
 #include "../include/lowRateListDecoder.h"
-
-void ISTC_sim(CodeInformation code, int rank);
-std::vector<int> generateRandomCRCMessage(CodeInformation code);
-std::vector<int> generateTransmittedMessage(std::vector<int> originalMessage, FeedForwardTrellis encodingTrellis, double snr, std::vector<int> puncturedIndices, bool noiseless);
-std::vector<double> addAWNGNoise(std::vector<int> transmittedMessage, std::vector<int> puncturedIndices, double snr, bool noiseless);
-void logSimulationParams();
+#include "../include/workStealingPool.h"
+#include "../include/trialRecords.h"
+#include "../include/recordWriter.h"
+#include "../include/histogram.h"
+#include "../include/trialRng.h"
+#include "../include/errorEventSampler.h"
+
+// what one pool thread keeps across trials and Eb/N0 points: its own encoder, decoder, random
+// stream and frame buffers, so the threads share nothing while they decode
+struct SimWorker {
+	SimWorker(CodeInformation code, int rank)
+		: encodingTrellis(code.k, code.n, code.v, code.numerators),
+		  listDecoder(encodingTrellis, MAX_LISTSIZE, code.crcDeg, code.crc, STOPPING_RULE),
+		  rng(BASE_SEED, rank),
+		  originalMessages(DECODE_BATCH_SIZE), transmittedMessages(DECODE_BATCH_SIZE), receivedMessages(DECODE_BATCH_SIZE) {}
+	FeedForwardTrellis encodingTrellis;
+	LowRateListDecoder listDecoder;
+	TrialRng rng;
+	std::vector<BitVector> originalMessages;     // message and crc bits
+	std::vector<BitVector> transmittedMessages;  // codeword bits, 0 for the BPSK point +1
+	std::vector<std::vector<double>> receivedMessages;
+	std::vector<MessageInformation> batchDecoding;
+};
+
+// counts of one Eb/N0 point, shared by the pool threads of a rank
+struct SimCounts {
+	std::atomic<int> mistakes{0};
+	std::atomic<int> failures{0};
+	std::atomic<int> trials{0};
+};
+
+// distributions of the trials of one Eb/N0 point, for OUTPUT_MODE 'H'. they take the place of the
+// per-trial files, and the ranks sum them into rank 0's once the point is done
+struct PointHistograms {
+	PointHistograms();
+	void add(const std::vector<TrialRecord>& records);
+	void reduce(int rank);
+	void write(double EbN0);
+	Histogram transmittedMetric;
+	std::vector<Histogram> listSizeMetric;  // list size x decoded metric, per decode type
+};
+
+// likelihood-ratio weighted sums over the trials of one Eb/N0 point, for IMPORTANCE_SAMPLING. the
+// weighted rates are unbiased for the nominal channel, and the sums of squared weights give their
+// variance. the ranks sum them into rank 0's once the point is done
+struct WeightedCounts {
+	enum { TRIALS, WEIGHTS, WEIGHTS_SQ, MISTAKES, MISTAKES_SQ, FAILURES, FAILURES_SQ, NUM_SUMS };
+	void add(const std::vector<TrialRecord>& records);
+	void reduce(int rank);
+	bool targetReached() const;
+	double sums[NUM_SUMS] = {};
+};
+
+// the decoding side of one rank: its pool threads and their workers, shared by every Eb/N0 point
+struct RankSimulation {
+	RankSimulation(CodeInformation code, int rank);
+	void runRound(int ebn0_id, SimCounts& counts);
+	void simulateEbN0Point(int ebn0_id);
+	void workEbN0Points();
+	void logWriterStats();
+
+	CodeInformation code;
+	int rank;
+	PuncturingPattern puncturing;
+	WorkStealingPool pool;
+	std::vector<SimWorker> workers;
+	std::vector<std::vector<TrialRecord>> roundRecords;    // records of the round, per pool task
+	std::vector<long long> pointRounds;                   // rounds run by this rank, per point
+	std::vector<std::unique_ptr<PointFiles>> pointFiles;  // opened by the first round of a point on this rank
+	RecordWriter writer;                                  // after pointFiles, so it drains before they close
+	std::vector<PointHistograms> pointHistograms;         // OUTPUT_MODE 'H' only
+	std::vector<WeightedCounts> pointWeights;             // IMPORTANCE_SAMPLING only
+	std::unique_ptr<ErrorEventSampler> sampler;           // IMPORTANCE_SAMPLING only, shared by the pool threads
+};
+
+// message tags of the dynamic scheduling
+const int REPORT_TAG = 1;
+const int ASSIGN_TAG = 2;
+const int WEIGHTS_TAG = 3;
+
+void ISTC_sim(CodeInformation code, int rank, int size);
+void reduceHistograms(std::vector<PointHistograms>& pointHistograms, int rank);
+void reduceWeightedCounts(std::vector<WeightedCounts>& pointWeights, int rank);
+void scheduleEbN0Points(int size);
+void logEbN0Results(double EbN0, long long num_mistakes, long long num_failures, long long num_trials);
+void logWeightedResults(double EbN0, const WeightedCounts& counts);
+double weightedHalfWidth(double trials, double weightSum, double squareSum);
+void simulateBatch(SimWorker& worker, CodeInformation code, int rank, int ebn0_id, long long firstTrial, double snr, const std::vector<int>& puncturedIndices, const PuncturingPattern& puncturing, const ErrorEventSampler* sampler, SimCounts& counts, std::vector<TrialRecord>& records);
+void generateRandomCRCMessage(CodeInformation code, TrialRng& rng, BitVector& message);
+double addAWNGNoise(const BitVector& transmittedMessage, const std::vector<int>& puncturedIndices, double snr, bool noiseless, const ErrorEventSampler* sampler, TrialRng& rng, std::vector<double>& receivedMessage);
+bool parseCodeArgs(int argc, char* argv[], CodeInformation& code);
+void logSimulationParams(CodeInformation code);
 
 int main(int argc, char *argv[]) {
     
   CodeInformation code;
   code.k = K;         // numerator of the rate
   code.n = N;         // denominator of the rate
-  code.v = V;         // number of memory elements
+  code.v = V;         // number of memory elements, the command line may override it and the polynomials, see parseCodeArgs
   code.crcDeg = M+1;  // m+1, degree of CRC, # bits of CRC polynomial
   code.crc = CRC;     // CRC polynomial
   code.numInfoBits = NUM_INFO_BITS; // number of information bits
@@ -39,8 +128,20 @@ int main(int argc, char *argv[]) {
 	MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
 	MPI_Comm_size(MPI_COMM_WORLD, &world_size);
 
+	// every rank parses the same arguments, so they all stop on a bad one
+	if (!parseCodeArgs(argc, argv, code)) {
+		if (world_rank == 0) {
+			std::cerr << "usage: " << argv[0] << " [v";
+			for (int i = 1; i <= code.n; i++)
+				std::cerr << " poly" << i;
+			std::cerr << "], polynomials in octal digits as in mla_consts.h" << std::endl;
+		}
+		MPI_Finalize();
+		return 1;
+	}
+
 	if (world_rank == 0) {
-		logSimulationParams();
+		logSimulationParams(code);
 	}
 
 	MPI_Barrier(MPI_COMM_WORLD);
@@ -51,186 +152,468 @@ int main(int argc, char *argv[]) {
 			exit(1);
 	}
 
-	srand(BASE_SEED + world_rank);  // Reproducible random seed
-
-	ISTC_sim(code, world_rank);  // Run simulation
+	// the random draws are keyed by rank and trial, see TrialRng
+	ISTC_sim(code, world_rank, world_size);  // Run simulation
 
 	MPI_Finalize();
 
   return 0;
 }
 
-void ISTC_sim(CodeInformation code, int rank){
-
-	for (size_t ebn0_id = 0; ebn0_id < EBN0.size(); ebn0_id++) {
-
-		/* - Output files setup - */
-		double EbN0 = EBN0[ebn0_id];
-		std::ostringstream ebn0_str;
-		ebn0_str.precision(2);
-		ebn0_str << std::fixed << EbN0;
-
-		std::ostringstream ude_error_cnt_str;
-		ude_error_cnt_str.precision(1);
-		ude_error_cnt_str << std::fixed << MAX_ERRORS;
-		
-		std::string folder_name = "output/Proc" + std::to_string(rank) + "_EbN0_" + ebn0_str.str() + "_ude_" + ude_error_cnt_str.str();
-		system(("mkdir -p " + folder_name).c_str());
-		
-		std::string RtoT_Metric_filename = folder_name + "/transmitted_metric.txt";
-		std::ofstream RRVtoTransmitted_MetricFile(RtoT_Metric_filename.c_str());
-
-		std::string RtoD_Metric_filename = folder_name + "/decoded_metric.txt";
-		std::ofstream RRVtoDecoded_MetricFile(RtoD_Metric_filename.c_str());
-
-		std::string RtoD_LS_filename = folder_name + "/decoded_listsize.txt";
-		std::ofstream RRVtoDecoded_ListSizeFile(RtoD_LS_filename.c_str());
-		
-		std::string RtoD_Type_filename = folder_name + "/decoded_type.txt";
-		std::ofstream RRVtoDecoded_DecodeTypeFile(RtoD_Type_filename);
-		
-		/* - Simulation SNR setup - */
-		std::vector<int> puncturedIndices = PUNCTURING_INDICES;
-		double snr = 0.0;
-		double offset = 10 * log10((double)N/K *NUM_INFO_BITS / (NUM_CODED_SYMBOLS));
-		snr = EbN0 + offset;
-		
-		/* - Trellis setup - */
-		FeedForwardTrellis encodingTrellis(code.k, code.n, code.v, code.numerators);
-
-		/* - Decoder setup - */
-		LowRateListDecoder listDecoder(encodingTrellis, MAX_LISTSIZE, code.crcDeg, code.crc, STOPPING_RULE);
-
-		/* - Output Temporary Holder setup - */
-		std::vector<double> RRVtoTransmitted_Metric;
-		std::vector<double> RRVtoDecoded_Metric;
-		std::vector<int> 		RRVtoDecoded_ListSize;
-		std::vector<int>		RRV_DecodedType;
-
-		/* ==== SIMULATION begins ==== */
-		std::cout << std::endl << "**- Simulation Started for EbN0 = " << std::fixed << std::setprecision(2) << EbN0 << " -**" << std::endl;
-		int num_mistakes 	= 0;
-		int num_failures 	= 0;
-		int num_errors 	 	= 0; // num_mistakes + num_failures
-		int num_trials	 	= 0;
-
-		while (num_mistakes < MAX_ERRORS) {
-
-			std::vector<int> originalMessage = generateRandomCRCMessage(code);
-			std::vector<int> transmittedMessage = generateTransmittedMessage(originalMessage, encodingTrellis, snr, puncturedIndices, NOISELESS);
-			std::vector<double> receivedMessage = addAWNGNoise(transmittedMessage, puncturedIndices, snr, NOISELESS);
-			std::vector<int> zero_point(receivedMessage.size(), 0);
-		
-
-			// Transmitted statistics
-			RRVtoTransmitted_Metric.push_back(utils::sum_of_squares(receivedMessage, transmittedMessage, puncturedIndices));
-			
-			// Decoding
-			MessageInformation standardDecoding = listDecoder.decode(receivedMessage, puncturedIndices);
-			
-
-			// RRV
-			if (standardDecoding.message == originalMessage) {
-				// correct decoding
-				RRV_DecodedType.push_back(0);
-				RRVtoDecoded_ListSize.push_back(standardDecoding.listSize);
-				RRVtoDecoded_Metric.push_back(standardDecoding.metric);
-			} else if(standardDecoding.listSizeExceeded) {
-				// list size exceeded
-				RRV_DecodedType.push_back(1);
-				num_failures++;
-			} else { 
-				// incorrect decoding
-				RRV_DecodedType.push_back(2);
-				RRVtoDecoded_ListSize.push_back(standardDecoding.listSize);
-				RRVtoDecoded_Metric.push_back(standardDecoding.metric);
-				num_mistakes++;
+void ISTC_sim(CodeInformation code, int rank, int size){
+
+	if (DYNAMIC_SCHEDULING && size > 1) {
+		// rank 0 hands out rounds, every other rank decodes them
+		if (rank == 0) {
+			scheduleEbN0Points(size);
+			std::vector<PointHistograms> pointHistograms(OUTPUT_MODE == 'H' ? EBN0.size() : 0);
+			reduceHistograms(pointHistograms, rank);
+			std::vector<WeightedCounts> pointWeights(IMPORTANCE_SAMPLING ? EBN0.size() : 0);
+			reduceWeightedCounts(pointWeights, rank);
+		} else {
+			RankSimulation simulation(code, rank);
+			simulation.workEbN0Points();
+			simulation.logWriterStats();
+			reduceHistograms(simulation.pointHistograms, rank);
+			reduceWeightedCounts(simulation.pointWeights, rank);
+		}
+	} else {
+		// every rank sweeps the points in order
+		RankSimulation simulation(code, rank);
+		for (size_t ebn0_id = 0; ebn0_id < EBN0.size(); ebn0_id++)
+			simulation.simulateEbN0Point(ebn0_id);
+		simulation.logWriterStats();
+	}
+
+	if (rank == 0)
+		std::cout << "***--- Simulation Concluded ---***" << std::endl;
+}
+
+RankSimulation::RankSimulation(CodeInformation code, int rank)
+	: code(code), rank(rank),
+	  puncturing(PUNCTURING_INDICES, code.n / code.k * (code.numInfoBits + code.crcDeg - 1)),
+	  pool(SIM_THREADS > 0 ? SIM_THREADS : (int)std::thread::hardware_concurrency()),
+	  roundRecords((LOGGING_ITERS + DECODE_BATCH_SIZE - 1) / DECODE_BATCH_SIZE),
+	  pointRounds(EBN0.size(), 0),
+	  pointFiles(EBN0.size()),
+	  pointHistograms(OUTPUT_MODE == 'H' ? EBN0.size() : 0),
+	  pointWeights(IMPORTANCE_SAMPLING ? EBN0.size() : 0) {
+	/* - Thread pool setup - */
+	// every thread decodes with its own decoder and buffers, see SimWorker
+	workers.reserve(pool.size());
+	for (int worker = 0; worker < pool.size(); worker++)
+		workers.emplace_back(code, rank);
+	if (IMPORTANCE_SAMPLING) {
+		sampler.reset(new ErrorEventSampler(code, puncturing, IS_EVENT_SPAN, IS_MEAN_SHIFT));
+		if (rank == 0)
+			std::cout << "Importance sampling events of weight " << sampler->minEventWeight() << " to " << sampler->maxEventWeight() << std::endl;
+	}
+}
+
+// trials run in rounds of about LOGGING_ITERS, one pool task per DECODE_BATCH_SIZE frames. the pool
+// balances a round across the threads, and the records go to the writer thread in task order. the
+// trials of a point are numbered by round, task and frame, so a trial draws the same bits and noise
+// whichever thread runs it
+void RankSimulation::runRound(int ebn0_id, SimCounts& counts){
+	/* - Simulation SNR setup - */
+	double offset = 10 * log10((double)N/K *NUM_INFO_BITS / (NUM_CODED_SYMBOLS));
+	double snr = EBN0[ebn0_id] + offset;
+
+	long long firstTrial = pointRounds[ebn0_id]++ * (long long)roundRecords.size() * DECODE_BATCH_SIZE;
+	pool.run(roundRecords.size(), [&](int worker, int task) {
+		simulateBatch(workers[worker], code, rank, ebn0_id, firstTrial + (long long)task * DECODE_BATCH_SIZE, snr, puncturing.indices, puncturing, sampler.get(), counts, roundRecords[task]);
+	});
+
+	if (IMPORTANCE_SAMPLING) {
+		for (size_t task = 0; task < roundRecords.size(); task++)
+			pointWeights[ebn0_id].add(roundRecords[task]);
+	}
+	if (OUTPUT_MODE == 'H') {
+		for (size_t task = 0; task < roundRecords.size(); task++) {
+			pointHistograms[ebn0_id].add(roundRecords[task]);
+			roundRecords[task].clear();
+		}
+		return;
+	}
+	if (!pointFiles[ebn0_id])
+		pointFiles[ebn0_id].reset(new PointFiles(rank, EBN0[ebn0_id]));
+	writer.submit(pointFiles[ebn0_id].get(), roundRecords);
+}
+
+// one point of the static sweep, on every rank at once
+void RankSimulation::simulateEbN0Point(int ebn0_id){
+	/* ==== SIMULATION begins ==== */
+	if (rank == 0)
+		std::cout << std::endl << "**- Simulation Started for EbN0 = " << std::fixed << std::setprecision(2) << EBN0[ebn0_id] << " -**" << std::endl;
+	SimCounts counts;
+
+	// the ranks pool their counts after every round. the reduction runs while the next round
+	// decodes and is waited on after it, then every rank sees the same totals and stops together
+	// once MAX_ERRORS mistakes are counted across all of them, or under IMPORTANCE_SAMPLING once the
+	// pooled weighted sums pin the mistake rate down, see WeightedCounts::targetReached
+	long long localCounts[3];  // mistakes, failures, trials
+	long long globalCounts[3];
+	WeightedCounts localWeights, globalWeights;
+	MPI_Request requests[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};  // counts, weighted sums
+	bool globalTargetReached = false;
+
+	while (!globalTargetReached) {
+		runRound(ebn0_id, counts);
+
+		// totals as of the previous round
+		if (requests[0] != MPI_REQUEST_NULL) {
+			MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+			if (rank == 0)
+				std::cout << "numTrials = " << globalCounts[2] << ", numErrors = " << globalCounts[0] + globalCounts[1] << std::endl; 
+			globalTargetReached = IMPORTANCE_SAMPLING ? globalWeights.targetReached() : globalCounts[0] >= MAX_ERRORS;
+		}
+		if (!globalTargetReached) {
+			localCounts[0] = counts.mistakes;
+			localCounts[1] = counts.failures;
+			localCounts[2] = counts.trials;
+			MPI_Iallreduce(localCounts, globalCounts, 3, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD, &requests[0]);
+			if (IMPORTANCE_SAMPLING) {
+				// a copy, the next round adds to the point's sums while the reduction reads these
+				localWeights = pointWeights[ebn0_id];
+				MPI_Iallreduce(localWeights.sums, globalWeights.sums, WeightedCounts::NUM_SUMS, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD, &requests[1]);
 			}
+		}
+	} // while (!globalTargetReached)
+
+	// the last round is not in the running totals, rank 0 reports every counted trial
+	localCounts[0] = counts.mistakes;
+	localCounts[1] = counts.failures;
+	localCounts[2] = counts.trials;
+	MPI_Reduce(localCounts, globalCounts, 3, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+	if (rank == 0)
+		logEbN0Results(EBN0[ebn0_id], globalCounts[0], globalCounts[1], globalCounts[2]);
+	if (IMPORTANCE_SAMPLING) {
+		pointWeights[ebn0_id].reduce(rank);
+		if (rank == 0)
+			logWeightedResults(EBN0[ebn0_id], pointWeights[ebn0_id]);
+	}
 
-			// Increment errors and trials
-			num_errors = num_mistakes + num_failures;
-			num_trials += 1;
+	// RRV
+	writer.drain();
+	pointFiles[ebn0_id].reset();
+	if (OUTPUT_MODE == 'H') {
+		pointHistograms[ebn0_id].reduce(rank);
+		if (rank == 0)
+			pointHistograms[ebn0_id].write(EBN0[ebn0_id]);
+	}
+}
 
-			if (num_trials % LOGGING_ITERS == 0 || num_errors == MAX_ERRORS) {
-				 std::cout << "numTrials = " << num_trials << ", numErrors = " << num_errors << std::endl; 
+// a rank of a dynamic run other than rank 0. it reports the counts of its last round and gets the
+// point of its next one, until every point is closed, see scheduleEbN0Points. under
+// IMPORTANCE_SAMPLING the report is followed by the rank's weighted sums of that point so far
+void RankSimulation::workEbN0Points(){
+	long long report[4] = {-1, 0, 0, 0};  // point, mistakes, failures, trials, point -1 for no round yet
+	while (true) {
+		MPI_Send(report, 4, MPI_LONG_LONG, 0, REPORT_TAG, MPI_COMM_WORLD);
+		if (IMPORTANCE_SAMPLING && report[0] >= 0)
+			MPI_Send(pointWeights[report[0]].sums, WeightedCounts::NUM_SUMS, MPI_DOUBLE, 0, WEIGHTS_TAG, MPI_COMM_WORLD);
+		int ebn0_id;
+		MPI_Recv(&ebn0_id, 1, MPI_INT, 0, ASSIGN_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		if (ebn0_id < 0)
+			break;
+
+		SimCounts counts;
+		runRound(ebn0_id, counts);
+		report[0] = ebn0_id;
+		report[1] = counts.mistakes;
+		report[2] = counts.failures;
+		report[3] = counts.trials;
+	}
+	
+	// RRV
+	writer.drain();
+	for (size_t ebn0_id = 0; ebn0_id < pointFiles.size(); ebn0_id++)
+		pointFiles[ebn0_id].reset();
+}
 
-				// RRV Write to file
-				if (RRVtoTransmitted_MetricFile.is_open()) {
-					for (int i = 0; i < RRVtoTransmitted_Metric.size(); i++) {
-						RRVtoTransmitted_MetricFile << RRVtoTransmitted_Metric[i] << std::endl;
-					}
-					RRVtoTransmitted_Metric.clear();
-				}
-				if (RRVtoDecoded_MetricFile.is_open()) {
-					for (int i = 0; i < RRVtoDecoded_Metric.size(); i++) {
-						RRVtoDecoded_MetricFile << RRVtoDecoded_Metric[i] << std::endl;
-					}
-					RRVtoDecoded_Metric.clear();
-				}
-				if (RRVtoDecoded_ListSizeFile.is_open()) {
-					for (int i = 0; i < RRVtoDecoded_ListSize.size(); i++) {
-						RRVtoDecoded_ListSizeFile << RRVtoDecoded_ListSize[i] << std::endl;
-					}
-					RRVtoDecoded_ListSize.clear();
-				}
-				if (RRVtoDecoded_DecodeTypeFile.is_open()) {
-					for (int i = 0; i < RRV_DecodedType.size(); i++) {
-						RRVtoDecoded_DecodeTypeFile << RRV_DecodedType[i] << std::endl;
-					}
-					RRV_DecodedType.clear();
+// back-pressure of the record writer. stalled rounds are the ones where decoding waited on the files
+void RankSimulation::logWriterStats(){
+	RecordWriter::Stats stats = writer.stats();
+	std::cout << "Rank " << rank << " record writer: " << stats.rounds << " rounds, " << stats.records << " records, "
+						<< stats.stalledRounds << " stalled rounds (" << std::fixed << std::setprecision(3) << stats.stallSeconds << " s), "
+						<< stats.writeSeconds << " s writing" << std::endl;
+}
+
+// rank 0 of a dynamic run. whichever rank reports in gets its next round at the open point with the
+// fewest rounds in flight, so idle ranks move to the points still short of errors. a point closes
+// once MAX_ERRORS mistakes are counted on it, or under IMPORTANCE_SAMPLING once the weighted sums
+// of every rank pin its mistake rate down. rounds still in flight there are counted as well
+void scheduleEbN0Points(int size){
+	int numPoints = EBN0.size();
+	std::vector<long long> mistakes(numPoints, 0);
+	std::vector<long long> failures(numPoints, 0);
+	std::vector<long long> trials(numPoints, 0);
+	std::vector<int> roundsInFlight(numPoints, 0);
+	std::vector<bool> pointOpen(numPoints, true);
+	// the latest weighted sums of every rank per point, IMPORTANCE_SAMPLING only
+	std::vector<std::vector<WeightedCounts>> rankWeights(IMPORTANCE_SAMPLING ? numPoints : 0, std::vector<WeightedCounts>(size));
+
+	int activeRanks = size - 1;
+	while (activeRanks > 0) {
+		long long report[4];
+		MPI_Status status;
+		MPI_Recv(report, 4, MPI_LONG_LONG, MPI_ANY_SOURCE, REPORT_TAG, MPI_COMM_WORLD, &status);
+		int reported = (int)report[0];
+		if (reported >= 0) {
+			mistakes[reported] += report[1];
+			failures[reported] += report[2];
+			trials[reported] += report[3];
+			roundsInFlight[reported]--;
+			std::cout << "EbN0 = " << std::fixed << std::setprecision(2) << EBN0[reported] << ": numTrials = " << trials[reported] << ", numErrors = " << mistakes[reported] + failures[reported] << std::endl;
+			bool targetReached = mistakes[reported] >= MAX_ERRORS;
+			if (IMPORTANCE_SAMPLING) {
+				MPI_Recv(rankWeights[reported][status.MPI_SOURCE].sums, WeightedCounts::NUM_SUMS, MPI_DOUBLE, status.MPI_SOURCE, WEIGHTS_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+				WeightedCounts pooled;
+				for (int source = 0; source < size; source++) {
+					for (int sum = 0; sum < WeightedCounts::NUM_SUMS; sum++)
+						pooled.sums[sum] += rankWeights[reported][source].sums[sum];
 				}
-			} // if (num_trials % LOGGING_ITERS == 0 || num_errors == MAX_ERRORS)
-		} // while (num_mistakes < MAX_ERRORS)
+				targetReached = pooled.targetReached();
+			}
+			if (pointOpen[reported] && targetReached) {
+				pointOpen[reported] = false;
+				std::cout << "*- EbN0 = " << std::fixed << std::setprecision(2) << EBN0[reported] << " closed -*" << std::endl;
+			}
+		}
+
+		int next = -1;
+		for (int ebn0_id = 0; ebn0_id < numPoints; ebn0_id++) {
+			if (pointOpen[ebn0_id] && (next == -1 || roundsInFlight[ebn0_id] < roundsInFlight[next]))
+				next = ebn0_id;
+		}
+		if (next == -1)
+			activeRanks--;
+		else
+			roundsInFlight[next]++;
+		MPI_Send(&next, 1, MPI_INT, status.MPI_SOURCE, ASSIGN_TAG, MPI_COMM_WORLD);
+	}
+
+	for (int ebn0_id = 0; ebn0_id < numPoints; ebn0_id++)
+		logEbN0Results(EBN0[ebn0_id], mistakes[ebn0_id], failures[ebn0_id], trials[ebn0_id]);
+}
+
+PointHistograms::PointHistograms()
+	: transmittedMetric(HistogramAxis::linear(HIST_METRIC_MIN, HIST_METRIC_MAX, HIST_METRIC_BINS)),
+	  listSizeMetric(3, Histogram(HistogramAxis::log2(1.0, HIST_LISTSIZE_OCTAVES, HIST_LISTSIZE_BINS_PER_OCTAVE),
+	                              HistogramAxis::linear(HIST_METRIC_MIN, HIST_METRIC_MAX, HIST_METRIC_BINS))) {}
+
+// under IMPORTANCE_SAMPLING a trial adds its likelihood ratio, so the bins estimate the nominal
+// channel's distributions
+void PointHistograms::add(const std::vector<TrialRecord>& records){
+	for (size_t i = 0; i < records.size(); i++) {
+		double weight = IMPORTANCE_SAMPLING ? std::exp(records[i].logWeight) : 1.0;
+		transmittedMetric.addWeighted(records[i].transmittedMetric, weight);
+		listSizeMetric[records[i].decodedType].addWeighted(records[i].listSize, records[i].decodedMetric, weight);
+	}
+}
 
-		std::cout << std::endl << "At Eb/N0 = " << std::fixed << std::setprecision(2) << EbN0 << std::endl;
-		std::cout << "number of errors: " << num_errors << std::endl;
-		std::cout << "number of mistakes: " << num_mistakes << std::endl;
-		std::cout << "number of failures: " << num_failures << std::endl;
-		std::cout << "Mistakes Error Rate: " << std::scientific << (double)num_mistakes/num_trials << std::endl;
-		std::cout << "Failures Error Rate: " << std::scientific << (double)num_failures/num_trials << std::endl;
-		std::cout << "TFR: " << (double)num_errors/num_trials << std::endl;
-		std::cout << "*- Simulation Concluded for EbN0 = " << std::fixed << std::setprecision(2) << EbN0 << " -*" << std::endl;
+// sums the histograms of every rank into rank 0's
+void PointHistograms::reduce(int rank){
+	std::vector<Histogram*> histograms = {&transmittedMetric, &listSizeMetric[0], &listSizeMetric[1], &listSizeMetric[2]};
+	for (size_t i = 0; i < histograms.size(); i++) {
+		std::vector<double>& counts = histograms[i]->counts();
+		MPI_Reduce(rank == 0 ? MPI_IN_PLACE : counts.data(), counts.data(), counts.size(), MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+	}
+}
+
+// the pooled histograms of a point, nonzero bins only
+void PointHistograms::write(double EbN0){
+	std::ostringstream ebn0_str;
+	ebn0_str.precision(2);
+	ebn0_str << std::fixed << EbN0;
+
+	std::ostringstream ude_error_cnt_str;
+	ude_error_cnt_str.precision(1);
+	ude_error_cnt_str << std::fixed << MAX_ERRORS;
+
+	std::string folder_name = "output/Hist_EbN0_" + ebn0_str.str() + "_ude_" + ude_error_cnt_str.str();
+	system(("mkdir -p " + folder_name).c_str());
+
+	std::ofstream transmittedMetricFile(folder_name + "/transmitted_metric.csv");
+	transmittedMetric.writeCsv(transmittedMetricFile);
+	for (int decodedType = 0; decodedType < 3; decodedType++) {
+		std::ofstream listSizeMetricFile(folder_name + "/listsize_metric_type" + std::to_string(decodedType) + ".csv");
+		listSizeMetric[decodedType].writeCsv(listSizeMetricFile);
+	}
+}
+
+// the histograms of a dynamic run, where the points end at different times, are summed once every
+// point is closed. rank 0 does not decode and adds empty ones
+void reduceHistograms(std::vector<PointHistograms>& pointHistograms, int rank){
+	for (size_t ebn0_id = 0; ebn0_id < pointHistograms.size(); ebn0_id++) {
+		pointHistograms[ebn0_id].reduce(rank);
+		if (rank == 0)
+			pointHistograms[ebn0_id].write(EBN0[ebn0_id]);
+	}
+}
 
-		
+void WeightedCounts::add(const std::vector<TrialRecord>& records){
+	for (size_t i = 0; i < records.size(); i++) {
+		double weight = std::exp(records[i].logWeight);
+		sums[TRIALS] += 1.0;
+		sums[WEIGHTS] += weight;
+		sums[WEIGHTS_SQ] += weight * weight;
+		if (records[i].decodedType == 2) {
+			sums[MISTAKES] += weight;
+			sums[MISTAKES_SQ] += weight * weight;
+		} else if (records[i].decodedType == 1) {
+			sums[FAILURES] += weight;
+			sums[FAILURES_SQ] += weight * weight;
+		}
+	}
+}
+
+// sums the weighted counts of every rank into rank 0's
+void WeightedCounts::reduce(int rank){
+	MPI_Reduce(rank == 0 ? MPI_IN_PLACE : sums, sums, NUM_SUMS, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+}
+
+// whether the confidence interval of the weighted mistake rate is within IS_RELATIVE_HALF_WIDTH of
+// it. the weights make a count of mistakes meaningless, equal weights need about
+// (CONFIDENCE_Z / IS_RELATIVE_HALF_WIDTH)^2 mistakes, and fewer trials reach it the closer the
+// sampling channel is to the mistakes
+bool WeightedCounts::targetReached() const{
+	double mistakes = sums[MISTAKES];
+	return mistakes > 0 && weightedHalfWidth(sums[TRIALS], mistakes, sums[MISTAKES_SQ]) <= IS_RELATIVE_HALF_WIDTH * mistakes / sums[TRIALS];
+}
+
+// the weighted counts of a dynamic run are summed once every point is closed, like its histograms
+void reduceWeightedCounts(std::vector<WeightedCounts>& pointWeights, int rank){
+	for (size_t ebn0_id = 0; ebn0_id < pointWeights.size(); ebn0_id++) {
+		pointWeights[ebn0_id].reduce(rank);
+		if (rank == 0)
+			logWeightedResults(EBN0[ebn0_id], pointWeights[ebn0_id]);
+	}
+}
+
+void logEbN0Results(double EbN0, long long num_mistakes, long long num_failures, long long num_trials){
+	long long num_errors = num_mistakes + num_failures;
+	std::cout << std::endl << "At Eb/N0 = " << std::fixed << std::setprecision(2) << EbN0 << std::endl;
+	std::cout << "number of trials: " << num_trials << std::endl;
+	std::cout << "number of errors: " << num_errors << std::endl;
+	std::cout << "number of mistakes: " << num_mistakes << std::endl;
+	std::cout << "number of failures: " << num_failures << std::endl;
+	std::cout << "Mistakes Error Rate: " << std::scientific << (double)num_mistakes/num_trials << std::endl;
+	std::cout << "Failures Error Rate: " << std::scientific << (double)num_failures/num_trials << std::endl;
+	std::cout << "TFR: " << (double)num_errors/num_trials << std::endl;
+	std::cout << "*- Simulation Concluded for EbN0 = " << std::fixed << std::setprecision(2) << EbN0 << " -*" << std::endl;
+}
+
+// the weighted rates with their normal confidence intervals. the mean weight should stay near 1 and
+// the effective trials near the trials, or the sampling channel is too far from the nominal one
+void logWeightedResults(double EbN0, const WeightedCounts& counts){
+	const double* sums = counts.sums;
+	double trials = sums[WeightedCounts::TRIALS];
+	if (trials == 0)
+		return;
+	std::cout << std::endl << "Importance sampling at Eb/N0 = " << std::fixed << std::setprecision(2) << EbN0 << std::endl;
+	std::cout << "mean weight: " << std::scientific << sums[WeightedCounts::WEIGHTS] / trials << std::endl;
+	std::cout << "effective trials: " << std::fixed << std::setprecision(1)
+						<< sums[WeightedCounts::WEIGHTS] * sums[WeightedCounts::WEIGHTS] / sums[WeightedCounts::WEIGHTS_SQ] << std::endl;
+
+	const char* names[3] = {"Weighted Mistakes Error Rate", "Weighted Failures Error Rate", "Weighted TFR"};
+	double weightSums[3] = {sums[WeightedCounts::MISTAKES], sums[WeightedCounts::FAILURES], sums[WeightedCounts::MISTAKES] + sums[WeightedCounts::FAILURES]};
+	double squareSums[3] = {sums[WeightedCounts::MISTAKES_SQ], sums[WeightedCounts::FAILURES_SQ], sums[WeightedCounts::MISTAKES_SQ] + sums[WeightedCounts::FAILURES_SQ]};
+	for (int i = 0; i < 3; i++) {
+		double rate = weightSums[i] / trials;
+		double halfWidth = weightedHalfWidth(trials, weightSums[i], squareSums[i]);
+		std::cout << names[i] << ": " << std::scientific << std::setprecision(3) << rate
+							<< " [" << std::max(rate - halfWidth, 0.0) << ", " << rate + halfWidth << "]" << std::endl;
+	}
+}
+
+// CONFIDENCE_Z normal half width of a weighted rate, from the sums of the weights and squared weights
+double weightedHalfWidth(double trials, double weightSum, double squareSum){
+	double rate = weightSum / trials;
+	return CONFIDENCE_Z * std::sqrt(std::max(squareSum / trials - rate * rate, 0.0) / trials);
+}
+
+// generates, decodes and tallies DECODE_BATCH_SIZE trials on one pool thread. every trial of a
+// round is counted, the MAX_ERRORS cap only stops the next round from starting, so the counts of a
+// round depend on its trial numbers and not on how the pool ran it
+void simulateBatch(SimWorker& worker, CodeInformation code, int rank, int ebn0_id, long long firstTrial, double snr, const std::vector<int>& puncturedIndices, const PuncturingPattern& puncturing, const ErrorEventSampler* sampler, SimCounts& counts, std::vector<TrialRecord>& records){
+	std::vector<BitVector>& originalMessages = worker.originalMessages;
+	std::vector<BitVector>& transmittedMessages = worker.transmittedMessages;
+	std::vector<std::vector<double>>& receivedMessages = worker.receivedMessages;
+	for (int frame = 0; frame < DECODE_BATCH_SIZE; frame++) {
+		worker.rng.startTrial(firstTrial + frame, ebn0_id);
+		generateRandomCRCMessage(code, worker.rng, originalMessages[frame]);
+	}
+	// the frames are encoded together, the bit and noise streams of a trial do not depend on each other
+	worker.encodingTrellis.encodeBatch(originalMessages, transmittedMessages);
+	double logWeights[DECODE_BATCH_SIZE];
+	for (int frame = 0; frame < DECODE_BATCH_SIZE; frame++) {
+		worker.rng.startTrial(firstTrial + frame, ebn0_id);
+		logWeights[frame] = addAWNGNoise(transmittedMessages[frame], puncturedIndices, snr, NOISELESS, sampler, worker.rng, receivedMessages[frame]);
+	}
+
+	// Decoding
+	worker.listDecoder.decodeBatch(receivedMessages, puncturing, worker.batchDecoding);
+
+	for (int frame = 0; frame < DECODE_BATCH_SIZE; frame++) {
+		MessageInformation& standardDecoding = worker.batchDecoding[frame];
+
+		// Transmitted statistics
+		TrialRecord record;
+		record.trialId = firstTrial + frame;
+		record.transmittedMetric = utils::sum_of_squares(receivedMessages[frame], transmittedMessages[frame], puncturing);
+		record.logWeight = logWeights[frame];
+		record.decodedMetric = standardDecoding.metric;
+		record.listSize = standardDecoding.listSize;
+		record.TBListSize = standardDecoding.TBListSize;
+		record.rank = rank;
 
 		// RRV
-		RRVtoTransmitted_MetricFile.close();
-		RRVtoDecoded_MetricFile.close();
-		RRVtoDecoded_ListSizeFile.close();
-		RRVtoDecoded_DecodeTypeFile.close();
-	} // for (size_t ebn0_id = 0; ebn0_id < EBN0.size(); ebn0_id++) 
+		if (standardDecoding.message == originalMessages[frame]) {
+			// correct decoding
+			record.decodedType = 0;
+		} else if(standardDecoding.listSizeExceeded) {
+			// list size exceeded
+			record.decodedType = 1;
+		} else {
+			// incorrect decoding
+			record.decodedType = 2;
+		}
 
-	std::cout << "***--- Simulation Concluded ---***" << std::endl;
+		// Increment errors and trials
+		if (record.decodedType == 2)
+			counts.mistakes++;
+		if (record.decodedType == 1)
+			counts.failures++;
+		counts.trials++;
+		records.push_back(record);
+	}
 }
 
 
 // this generates a random binary string of length code.numInfoBits, and appends the appropriate CRC bits
-std::vector<int> generateRandomCRCMessage(CodeInformation code){
-	std::vector<int> message;
-	for(int i = 0; i < code.numInfoBits; i++)
-		message.push_back(rand()%2);
+void generateRandomCRCMessage(CodeInformation code, TrialRng& rng, BitVector& message){
+	message.reset(code.numInfoBits);
+	rng.bits(message.words(), code.numInfoBits);
 	// compute the CRC
 	crc::crc_calculation(message, code.crcDeg, code.crc);
-	return message;
-}
-
-// this takes the message bits, including the CRC, and encodes them using the trellis
-std::vector<int> generateTransmittedMessage(std::vector<int> originalMessage, FeedForwardTrellis encodingTrellis, double snr, std::vector<int> puncturedIndices, bool noiseless){
-	// encode the message
-	std::vector<int> encodedMessage = encodingTrellis.encode(originalMessage);
-
-	return encodedMessage;
 }
 
 // this takes the transmitted message and adds AWGN noise to it
 // it also punctures the bits that are not used in the trellis
-std::vector<double> addAWNGNoise(std::vector<int> transmittedMessage, std::vector<int> puncturedIndices, double snr, bool noiseless){
-	std::vector<double> receivedMessage;
+// with a sampler the noise comes from the importance sampling channel, and the log likelihood ratio
+// of the trial is returned, 0 otherwise
+double addAWNGNoise(const BitVector& transmittedMessage, const std::vector<int>& puncturedIndices, double snr, bool noiseless, const ErrorEventSampler* sampler, TrialRng& rng, std::vector<double>& receivedMessage){
+	double logWeight = 0.0;
 	if(noiseless){
+		receivedMessage.resize(transmittedMessage.size());
 		for(int i = 0; i < transmittedMessage.size(); i++)
-			receivedMessage.push_back((double)transmittedMessage[i]);
+			receivedMessage[i] = 1 - 2 * transmittedMessage.get(i);
+	} else if (sampler) {
+		logWeight = sampler->addNoise(transmittedMessage, snr, rng, receivedMessage);
 	} else {
-		receivedMessage = awgn::addNoise(transmittedMessage, snr);
+		awgn::addNoise(transmittedMessage, snr, rng, receivedMessage);
 	}
 
 	// puncture the bits. it is more convenient to puncture on this side than on the 
@@ -243,11 +626,37 @@ std::vector<double> addAWNGNoise(std::vector<int> transmittedMessage, std::vecto
 		}
 		receivedMessage[puncturedIndices[index]] = 0;
 	}
+	return logWeight;
+}
 
-	return receivedMessage;
+// the code can be given as main v poly1 ... polyN, in place of V and the POLY constants. the
+// polynomials are octal digits, like 561, and must fit the v + 1 taps of the register
+bool parseCodeArgs(int argc, char* argv[], CodeInformation& code){
+	if (argc == 1)
+		return true;
+	if (argc != 2 + code.n)
+		return false;
+
+	std::string v = argv[1];
+	if (v.empty() || v.size() > 2 || v.find_first_not_of("0123456789") != std::string::npos)
+		return false;
+	code.v = std::stoi(v);
+	if (code.v < 1 || code.v > 15)
+		return false;
+
+	code.numerators.clear();
+	for (int i = 0; i < code.n; i++) {
+		std::string poly = argv[2 + i];
+		if (poly.empty() || poly.size() > 6 || poly.find_first_not_of("01234567") != std::string::npos)
+			return false;
+		if ((std::stoi(poly, nullptr, 8) >> (code.v + 1)) != 0)
+			return false;
+		code.numerators.push_back(std::stoi(poly));
+	}
+	return true;
 }
 
-void logSimulationParams() {
+void logSimulationParams(CodeInformation code) {
 	std::cout << "+----------------------+------------+\n";
 	std::cout << "| Parameter           | Value      |\n";
 	std::cout << "+----------------------+------------+\n";
@@ -257,8 +666,14 @@ void logSimulationParams() {
 						<< "| " << std::setw(10) << NUM_INFO_BITS << "|\n";
 	std::cout << "| " << std::left << std::setw(20) << "N"
 						<< "| " << std::setw(10) << NUM_CODED_SYMBOLS << "|\n";
+	std::cout << "| " << std::left << std::setw(20) << "V"
+						<< "| " << std::setw(10) << code.v << "|\n";
+	std::ostringstream polys;
+	for (size_t i = 0; i < code.numerators.size(); i++)
+		polys << (i == 0 ? "{" : ", ") << code.numerators[i];
+	polys << "}";
 	std::cout << "| " << std::left << std::setw(20) << "GEN POLY"
-						<< "| " << "{" << POLY1 << ", " << POLY2 << "}" << "|\n";
+						<< "| " << std::setw(10) << polys.str() << "|\n";
 	std::cout << "| " << std::left << std::setw(20) << "ELF"
 						<< "| " << "0x" << std::setw(10) << std::hex << CRC << std::dec << "|\n";
 	std::cout << "| " << std::left << std::setw(20) << "STOPPING RULE"
@@ -278,6 +693,28 @@ void logSimulationParams() {
 						<< "| " << std::setw(10) << NOISELESS << "|\n";
 	std::cout << "| " << std::left << std::setw(20) << "LOGGING ITERS"
 						<< "| " << std::setw(10) << LOGGING_ITERS << "|\n";
+	std::cout << "| " << std::left << std::setw(20) << "OUTPUT MODE"
+						<< "| " << std::setw(10) << OUTPUT_MODE << "|\n";
+	if (OUTPUT_MODE == 'H') {
+		std::cout << "| " << std::left << std::setw(20) << "HIST METRIC BINS"
+							<< "| " << std::setw(10) << HIST_METRIC_BINS << "|\n";
+		std::cout << "| " << std::left << std::setw(20) << "HIST LS BINS/OCT"
+							<< "| " << std::setw(10) << HIST_LISTSIZE_BINS_PER_OCTAVE << "|\n";
+	}
+	std::cout << "| " << std::left << std::setw(20) << "DYNAMIC SCHEDULING"
+						<< "| " << std::setw(10) << DYNAMIC_SCHEDULING << "|\n";
+	std::cout << "| " << std::left << std::setw(20) << "SIM THREADS"
+						<< "| " << std::setw(10) << SIM_THREADS << "|\n";
+	std::cout << "| " << std::left << std::setw(20) << "IMPORTANCE SAMPLING"
+						<< "| " << std::setw(10) << IMPORTANCE_SAMPLING << "|\n";
+	if (IMPORTANCE_SAMPLING) {
+		std::cout << "| " << std::left << std::setw(20) << "IS MEAN SHIFT"
+							<< "| " << std::setw(10) << IS_MEAN_SHIFT << "|\n";
+		std::cout << "| " << std::left << std::setw(20) << "IS EVENT SPAN"
+							<< "| " << std::setw(10) << IS_EVENT_SPAN << "|\n";
+		std::cout << "| " << std::left << std::setw(20) << "IS HALF WIDTH"
+							<< "| " << std::setw(10) << IS_RELATIVE_HALF_WIDTH << "|\n";
+	}
 	std::cout << "| " << std::left << std::setw(20) << "BASE SEED"
 	<< "| " << std::setw(10) << BASE_SEED << "|\n";
 
@@ -1,48 +1,76 @@
 #include "../include/minHeap.h"
 
-MinHeap::MinHeap() {
-  // constructor if necessary
-}
+MinHeap::MinHeap() : trace(nullptr) {}
 
-int MinHeap::parentIndex(int index) { return (index - 1) / 2; }
-int MinHeap::leftChildIndex(int index) { return (2 * index + 1); }
-int MinHeap::rightChildIndex(int index) { return (2 * index + 2); }
+int MinHeap::parentIndex(int index) { return (index - 1) / ARITY; }
+int MinHeap::firstChildIndex(int index) { return ARITY * index + 1; }
 
-void MinHeap::insert(DetourObject detour) {
-  detourList.push_back(detour);
-  int index = detourList.size() - 1;
-  while (index > 0 && detourList[parentIndex(index)] > detourList[index]) {
-    std::swap(detourList[parentIndex(index)], detourList[index]);
-    index = parentIndex(index);
+void MinHeap::insert(const DetourObject& detour) {
+  if (trace) {
+    trace->ops.push_back(HeapTrace::INSERT);
+    trace->inserted.push_back(detour);
   }
+  detourList.push_back(detour);
+  siftUp(detourList.size() - 1);
 }
 
 DetourObject MinHeap::pop() {
+  if (trace)
+    trace->ops.push_back(HeapTrace::POP);
   DetourObject detour = detourList[0];
   detourList[0] = detourList[detourList.size() - 1];
   detourList.pop_back();
-  reHeap(0);
+  if (!detourList.empty())
+    siftDown(0);
 
   return detour;
 }
 
 DetourObject MinHeap::top() { return detourList[0]; }
 
-void MinHeap::reHeap(int index) {
-  int leftIndex = leftChildIndex(index);
-  int rightIndex = rightChildIndex(index);
-  int minDetourIndex = index;
-  if (leftIndex < detourList.size() &&
-      detourList[leftIndex] < detourList[minDetourIndex])
-    minDetourIndex = leftIndex;
-  if (rightIndex < detourList.size() &&
-      detourList[rightIndex] < detourList[minDetourIndex])
-    minDetourIndex = rightIndex;
-
-  if (minDetourIndex != index) {
-    std::swap(detourList[index], detourList[minDetourIndex]);
-    reHeap(minDetourIndex);
+void MinHeap::reserve(size_t capacity) { detourList.reserve(capacity); }
+
+void MinHeap::clear() {
+  if (trace)
+    trace->ops.push_back(HeapTrace::CLEAR);
+  detourList.clear();
+}
+
+void MinHeap::record(HeapTrace* trace) { this->trace = trace; }
+
+// clears the heap and gives its storage back
+void MinHeap::release() { std::vector<DetourObject>().swap(detourList); }
+
+// moves the detour at index up until its parent is not larger
+void MinHeap::siftUp(int index) {
+  DetourObject detour = detourList[index];
+  while (index > 0 && detourList[parentIndex(index)] > detour) {
+    detourList[index] = detourList[parentIndex(index)];
+    index = parentIndex(index);
+  }
+  detourList[index] = detour;
+}
+
+// moves the detour at index down until none of its children is smaller
+void MinHeap::siftDown(int index) {
+  DetourObject detour = detourList[index];
+  int size = detourList.size();
+  while (true) {
+    int firstChild = firstChildIndex(index);
+    if (firstChild >= size)
+      break;
+    int lastChild = firstChild + ARITY < size ? firstChild + ARITY : size;
+    int minDetourIndex = firstChild;
+    for (int child = firstChild + 1; child < lastChild; child++) {
+      if (detourList[child] < detourList[minDetourIndex])
+        minDetourIndex = child;
+    }
+    if (!(detourList[minDetourIndex] < detour))
+      break;
+    detourList[index] = detourList[minDetourIndex];
+    index = minDetourIndex;
   }
+  detourList[index] = detour;
 }
 
-int MinHeap::size() { return detourList.size(); }
\ No newline at end of file
+int MinHeap::size() { return detourList.size(); }
@@ -18,6 +18,14 @@ std::vector<double> addNoise(std::vector<int> encodedMsg, double SNR) {
   return noisyMsg;
 }
 
+void addNoise(const BitVector& codeword, double SNR, TrialRng& rng, std::vector<double>& noisyMsg) {
+  double sigma = sqrt(pow(10.0, -SNR / 10.0));
+  noisyMsg.resize(codeword.size());
+  rng.normals(noisyMsg.data(), (int)noisyMsg.size(), sigma);
+  for (int i = 0; i < codeword.size(); i++)
+    noisyMsg[i] += 1 - 2 * codeword.get(i);
+}
+
 } // namespace awgn
 
 namespace crc {
@@ -51,8 +59,165 @@ int bin_sum(int i, int j) {
 	return (i + j) % 2;
 }
 
+Engine::Engine(int crc_bits_num, int crc_dec) {
+	this->crc_bits_num = crc_bits_num;
+	this->crc_dec = crc_dec;
+	this->degree = crc_bits_num - 1;
+	this->leadingBitSet = degree >= 0 && ((crc_dec >> degree) & 1);
+
+	// the polynomial without its leading term, shifted so its x^(degree-1) term is bit 63
+	uint64_t lowTerms = degree > 0 ? (uint64_t)crc_dec & ((1ull << degree) - 1) : 0;
+	this->alignedPoly = degree > 0 ? lowTerms << (64 - degree) : 0;
+
+	for (int byte = 0; byte < 256; byte++) {
+		uint64_t reg = (uint64_t)byte << 56;
+		for (int bit = 0; bit < 8; bit++)
+			reg = (reg >> 63) ? (reg << 1) ^ alignedPoly : reg << 1;
+		table[byte] = reg;
+	}
+}
+
+// the bitwise division leaves a set bit behind when the polynomial's leading bit is clear, and
+// never divides a message shorter than the polynomial, so those cases stay with the reference
+bool Engine::supports(int length) const {
+	return leadingBitSet && degree >= 1 && degree <= 56 && length >= crc_bits_num;
+}
+
+uint64_t Engine::remainder(const int* bits, int length) const {
+	uint64_t reg = 0;
+	int i = 0;
+	for (; i + 8 <= length; i += 8) {
+		unsigned int byte = 0;
+		for (int bit = 0; bit < 8; bit++)
+			byte = (byte << 1) | (bits[i + bit] & 1);
+		reg = (reg << 8) ^ table[(reg >> 56) ^ byte];
+	}
+	for (; i < length; i++) {
+		reg ^= (uint64_t)(bits[i] & 1) << 63;
+		reg = (reg >> 63) ? (reg << 1) ^ alignedPoly : reg << 1;
+	}
+	return reg >> (64 - degree);
+}
+
+// bits are packed least significant first and divided most significant first, so each byte of a
+// word is reversed on the way in. bytes start on multiples of 8 and never straddle two words
+static inline unsigned reverseByte(unsigned byte) {
+	byte = (byte & 0xF0) >> 4 | (byte & 0x0F) << 4;
+	byte = (byte & 0xCC) >> 2 | (byte & 0x33) << 2;
+	return (byte & 0xAA) >> 1 | (byte & 0x55) << 1;
+}
+
+uint64_t Engine::remainder(const BitVector& bits, int length) const {
+	const uint64_t* words = bits.words();
+	uint64_t reg = 0;
+	int i = 0;
+	for (; i + 8 <= length; i += 8) {
+		unsigned byte = reverseByte((words[i >> 6] >> (i & 63)) & 0xFF);
+		reg = (reg << 8) ^ table[(reg >> 56) ^ byte];
+	}
+	for (; i < length; i++) {
+		reg ^= (uint64_t)bits.get(i) << 63;
+		reg = (reg >> 63) ? (reg << 1) ^ alignedPoly : reg << 1;
+	}
+	return reg >> (64 - degree);
+}
+
+std::vector<uint64_t> Engine::bitWeights(int length) const {
+	std::vector<uint64_t> weights(length);
+	uint64_t weight = 1;
+	for (int i = length - 1; i >= 0; i--) {
+		weights[i] = weight;
+		weight <<= 1;
+		if ((weight >> degree) & 1)
+			weight ^= (uint64_t)crc_dec;
+	}
+	return weights;
+}
+
+// the message divides evenly exactly when the remainder of its data bits equals its crc bits
+bool Engine::check(const std::vector<int>& input_data) const {
+	int dataLength = (int)input_data.size() - degree;
+	uint64_t expected = remainder(input_data.data(), dataLength);
+	uint64_t received = 0;
+	for (int i = dataLength; i < (int)input_data.size(); i++)
+		received = (received << 1) | (uint64_t)(input_data[i] & 1);
+	return expected == received;
+}
+
+void Engine::append(std::vector<int>& input_data) const {
+	int length = (int)input_data.size();
+	uint64_t crcBits = remainder(input_data.data(), length);
+	input_data.resize(length + degree);
+	for (int i = 0; i < degree; i++)
+		input_data[length + i] = (crcBits >> (degree - 1 - i)) & 1;
+}
+
+bool Engine::check(const BitVector& input_data) const {
+	int dataLength = input_data.size() - degree;
+	uint64_t expected = remainder(input_data, dataLength);
+	uint64_t received = 0;
+	for (int i = dataLength; i < input_data.size(); i++)
+		received = (received << 1) | (uint64_t)input_data.get(i);
+	return expected == received;
+}
+
+void Engine::append(BitVector& input_data) const {
+	int length = input_data.size();
+	uint64_t crcBits = remainder(input_data, length);
+	input_data.resize(length + degree);
+	for (int i = 0; i < degree; i++)
+		input_data.set(length + i, (crcBits >> (degree - 1 - i)) & 1);
+}
+
+const Engine& engine(int crc_bits_num, int crc_dec) {
+	thread_local Engine cached(crc_bits_num, crc_dec);
+	if (cached.crcBitsNum() != crc_bits_num || cached.crcDec() != crc_dec)
+		cached = Engine(crc_bits_num, crc_dec);
+	return cached;
+}
+
 // checks the decoded message against the crc
-bool crc_check(std::vector<int> input_data, int crc_bits_num, int crc_dec) {
+bool crc_check(const std::vector<int>& input_data, int crc_bits_num, int crc_dec) {
+	const Engine& crcEngine = engine(crc_bits_num, crc_dec);
+	if (!crcEngine.supports((int)input_data.size()))
+		return crc_check_reference(input_data, crc_bits_num, crc_dec);
+	return crcEngine.check(input_data);
+}
+
+void crc_calculation(std::vector<int>& input_data, int crc_bits_num, int crc_dec) {
+	const Engine& crcEngine = engine(crc_bits_num, crc_dec);
+	// the appended crc bits extend the dividend, so the message itself may be short
+	if (!crcEngine.supports((int)input_data.size() + crc_bits_num)) {
+		crc_calculation_reference(input_data, crc_bits_num, crc_dec);
+		return;
+	}
+	crcEngine.append(input_data);
+}
+
+bool crc_check(const BitVector& input_data, int crc_bits_num, int crc_dec) {
+	const Engine& crcEngine = engine(crc_bits_num, crc_dec);
+	if (!crcEngine.supports(input_data.size())) {
+		std::vector<int> bits;
+		input_data.toInts(bits);
+		return crc_check_reference(bits, crc_bits_num, crc_dec);
+	}
+	return crcEngine.check(input_data);
+}
+
+void crc_calculation(BitVector& input_data, int crc_bits_num, int crc_dec) {
+	const Engine& crcEngine = engine(crc_bits_num, crc_dec);
+	if (!crcEngine.supports(input_data.size() + crc_bits_num)) {
+		std::vector<int> bits;
+		input_data.toInts(bits);
+		crc_calculation_reference(bits, crc_bits_num, crc_dec);
+		input_data = BitVector::fromInts(bits);
+		return;
+	}
+	crcEngine.append(input_data);
+}
+
+// checks the decoded message against the crc, by bitwise long division
+bool crc_check_reference(std::vector<int> input_data, int crc_bits_num, int crc_dec) {
 	std::vector<int> CRC;
 	dec_to_binary(crc_dec, CRC, crc_bits_num);
 
@@ -66,7 +231,7 @@ bool crc_check(std::vector<int> input_data, int crc_bits_num, int crc_dec) {
 	return zeros;
 }
 
-void crc_calculation(std::vector<int>& input_data, int crc_bits_num, int crc_dec){
+void crc_calculation_reference(std::vector<int>& input_data, int crc_bits_num, int crc_dec){
 	// crc_bits_num: the number of CRC bits, redundancy bits number is 1 less.
 	int length = (int)input_data.size();
 	std::vector<int> CRC;
@@ -109,6 +274,20 @@ void print_int_vector(std::vector<int> vector){
 	std::cout << vector[vector.size() - 1] << std::endl;
 }
 
+double sum_of_squares(const std::vector<double>& received, const BitVector& codeword, const PuncturingPattern& puncturing) {
+	if ((int)received.size() != codeword.size() || (int)received.size() != puncturing.length()) {
+		throw std::invalid_argument("Vectors must be of the same size");
+	}
+
+	const double* weights = puncturing.weights.data();
+	double sum = 0.0;
+	for (size_t i = 0; i < received.size(); i++) {
+		double diff = received[i] - (1 - 2 * codeword.get(i));
+		sum += weights[i] * diff * diff;
+	}
+	return sum;
+}
+
 // outputs a vector of ints to a file
 void output_int_vector(std::vector<int> vector, std::ofstream& file){
 	if(vector.size() == 0)
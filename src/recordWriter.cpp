@@ -0,0 +1,120 @@
+#include "../include/recordWriter.h"
+#include "../include/mla_consts.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+PointFiles::PointFiles(int rank, double EbN0){
+	/* - Output files setup - */
+	std::ostringstream ebn0_str;
+	ebn0_str.precision(2);
+	ebn0_str << std::fixed << EbN0;
+
+	std::ostringstream ude_error_cnt_str;
+	ude_error_cnt_str.precision(1);
+	ude_error_cnt_str << std::fixed << MAX_ERRORS;
+	
+	std::string folder_name = "output/Proc" + std::to_string(rank) + "_EbN0_" + ebn0_str.str() + "_ude_" + ude_error_cnt_str.str();
+	system(("mkdir -p " + folder_name).c_str());
+	
+	if (OUTPUT_MODE == 'B') {
+		recordFile.open(folder_name + "/records.bin", std::ios::binary);
+		records::writeHeader(recordFile, records::makeHeader(EbN0, rank));
+	} else {
+		RRVtoTransmitted_MetricFile.open(folder_name + "/transmitted_metric.txt");
+		RRVtoDecoded_MetricFile.open(folder_name + "/decoded_metric.txt");
+		RRVtoDecoded_ListSizeFile.open(folder_name + "/decoded_listsize.txt");
+		RRVtoDecoded_DecodeTypeFile.open(folder_name + "/decoded_type.txt");
+	}
+}
+
+// RRV Write to file. the streams flush when their buffers fill or the files close, not per value
+void PointFiles::write(std::vector<TrialRecord>& records){
+	if (recordFile.is_open()) {
+		records::writeRecords(recordFile, records);
+		return;
+	}
+
+	for (size_t i = 0; i < records.size(); i++) {
+		const TrialRecord& record = records[i];
+		if (RRVtoTransmitted_MetricFile.is_open())
+			RRVtoTransmitted_MetricFile << record.transmittedMetric << '\n';
+		if (record.decodedType != 1 && RRVtoDecoded_MetricFile.is_open())
+			RRVtoDecoded_MetricFile << record.decodedMetric << '\n';
+		if (record.decodedType != 1 && RRVtoDecoded_ListSizeFile.is_open())
+			RRVtoDecoded_ListSizeFile << record.listSize << '\n';
+		if (RRVtoDecoded_DecodeTypeFile.is_open())
+			RRVtoDecoded_DecodeTypeFile << record.decodedType << '\n';
+	}
+}
+
+RecordWriter::RecordWriter()
+	: writeTarget(nullptr), pending(false), stopping(false), counters() {
+	thread = std::thread(&RecordWriter::writerLoop, this);
+}
+
+RecordWriter::~RecordWriter(){
+	drain();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	roundPending.notify_one();
+	thread.join();
+}
+
+void RecordWriter::submit(PointFiles* files, std::vector<std::vector<TrialRecord>>& taskRecords){
+	fillBuffer.clear();
+	for (size_t task = 0; task < taskRecords.size(); task++) {
+		fillBuffer.insert(fillBuffer.end(), taskRecords[task].begin(), taskRecords[task].end());
+		taskRecords[task].clear();
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	if (pending) {
+		// back-pressure, the writer has not finished the previous round
+		std::chrono::steady_clock::time_point stallStart = std::chrono::steady_clock::now();
+		roundWritten.wait(lock, [this] { return !pending; });
+		counters.stalledRounds++;
+		counters.stallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - stallStart).count();
+	}
+	fillBuffer.swap(writeBuffer);
+	writeTarget = files;
+	pending = true;
+	counters.rounds++;
+	counters.records += writeBuffer.size();
+	lock.unlock();
+	roundPending.notify_one();
+}
+
+void RecordWriter::drain(){
+	std::unique_lock<std::mutex> lock(mutex);
+	roundWritten.wait(lock, [this] { return !pending; });
+}
+
+RecordWriter::Stats RecordWriter::stats(){
+	std::lock_guard<std::mutex> lock(mutex);
+	return counters;
+}
+
+void RecordWriter::writerLoop(){
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		roundPending.wait(lock, [this] { return pending || stopping; });
+		if (!pending)
+			return;
+
+		// the buffer and target are the writer's until pending is cleared
+		lock.unlock();
+		std::chrono::steady_clock::time_point writeStart = std::chrono::steady_clock::now();
+		writeTarget->write(writeBuffer);
+		double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - writeStart).count();
+		lock.lock();
+
+		counters.writeSeconds += writeSeconds;
+		pending = false;
+		roundWritten.notify_all();
+	}
+}
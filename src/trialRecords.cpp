@@ -0,0 +1,59 @@
+#include "../include/trialRecords.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace records {
+
+RecordFileHeader makeHeader(double EbN0, int rank) {
+  RecordFileHeader header;
+  std::memcpy(header.magic, RECORD_FILE_MAGIC, sizeof(header.magic));
+  header.version = RECORD_FILE_VERSION;
+  header.recordSize = sizeof(TrialRecord);
+  header.EbN0 = EbN0;
+  header.rank = rank;
+  header.reserved = 0;
+  return header;
+}
+
+void writeHeader(std::ostream& file, const RecordFileHeader& header) {
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void writeRecords(std::ostream& file, const std::vector<TrialRecord>& records) {
+  if (!records.empty())
+    file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(TrialRecord));
+}
+
+void readFile(const std::string& filename, RecordFileHeader& header, std::vector<TrialRecord>& records) {
+  std::ifstream file(filename.c_str(), std::ios::binary);
+  if (!file)
+    throw std::runtime_error("cannot open " + filename);
+
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, RECORD_FILE_MAGIC, sizeof(header.magic)) != 0)
+    throw std::runtime_error(filename + " is not a record file");
+  if (header.version != RECORD_FILE_VERSION || header.recordSize != sizeof(TrialRecord))
+    throw std::runtime_error(filename + " has an unsupported record format");
+
+  // the records run to the end of the file, a partly written last record is dropped
+  file.seekg(0, std::ios::end);
+  std::streamoff recordBytes = (std::streamoff)file.tellg() - (std::streamoff)sizeof(header);
+  file.seekg(sizeof(header), std::ios::beg);
+  records.resize(recordBytes / sizeof(TrialRecord));
+  if (!records.empty() && !file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(TrialRecord)))
+    throw std::runtime_error("cannot read " + filename);
+}
+
+void writeCsv(std::ostream& file, const std::vector<TrialRecord>& records) {
+  file.precision(17);
+  file << "rank,trial_id,decoded_type,transmitted_metric,decoded_metric,list_size,tb_list_size,log_weight\n";
+  for (size_t i = 0; i < records.size(); i++) {
+    const TrialRecord& record = records[i];
+    file << record.rank << ',' << record.trialId << ',' << record.decodedType << ','
+         << record.transmittedMetric << ',' << record.decodedMetric << ','
+         << record.listSize << ',' << record.TBListSize << ',' << record.logWeight << '\n';
+  }
+}
+
+} // namespace records
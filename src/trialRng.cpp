@@ -0,0 +1,223 @@
+#include "../include/trialRng.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MLA_X86_RNG
+#endif
+
+namespace {
+
+const uint32_t PHILOX_M0 = 0xD2511F53;
+const uint32_t PHILOX_M1 = 0xCD9E8D57;
+const uint32_t PHILOX_W0 = 0x9E3779B9;
+const uint32_t PHILOX_W1 = 0xBB67AE85;
+const int PHILOX_ROUNDS = 10;
+
+// the ten Philox rounds on `lanes` counters stored as counter[word][lane]. the lane loops are
+// innermost and branch free, so the compiler can keep one counter per vector lane
+template <int lanes>
+inline void philoxRounds(uint32_t counter[4][lanes], uint32_t key0, uint32_t key1) {
+  for (int round = 0; round < PHILOX_ROUNDS; round++) {
+    for (int lane = 0; lane < lanes; lane++) {
+      uint64_t product0 = (uint64_t)PHILOX_M0 * counter[0][lane];
+      uint64_t product1 = (uint64_t)PHILOX_M1 * counter[2][lane];
+      uint32_t x0 = (uint32_t)(product1 >> 32) ^ counter[1][lane] ^ key0;
+      uint32_t x2 = (uint32_t)(product0 >> 32) ^ counter[3][lane] ^ key1;
+      counter[0][lane] = x0;
+      counter[1][lane] = (uint32_t)product1;
+      counter[2][lane] = x2;
+      counter[3][lane] = (uint32_t)product0;
+    }
+    key0 += PHILOX_W0;
+    key1 += PHILOX_W1;
+  }
+}
+
+inline uint64_t doubleBits(double x) {
+  uint64_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+inline double bitsDouble(uint64_t bits) {
+  double x;
+  std::memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+// exact conversion of an integer below 2^52, through the exponent of 2^52. unlike a cast it only
+// takes integer instructions the vector units have without AVX-512
+const double TWO_52 = 4503599627370496.0;
+inline double smallToDouble(uint64_t x) {
+  return bitsDouble(0x4330000000000000ull | x) - TWO_52;
+}
+
+// 53 random bits from two words, as a double in (0, 1)
+inline double openUniform(uint32_t high, uint32_t low) {
+  uint64_t bits53 = ((uint64_t)high << 21) ^ (low >> 11);
+  return (2.0 * smallToDouble(bits53 >> 1) + smallToDouble(bits53 & 1) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// fdlibm's log and its sine and cosine kernels on [-pi/4, pi/4], all below one ulp
+const double LN2_HI = 6.93147180369123816490e-01;
+const double LN2_LO = 1.90821492927058770002e-10;
+const double LG1 = 6.666666666666735130e-01, LG2 = 3.999999999940941908e-01, LG3 = 2.857142874366239149e-01;
+const double LG4 = 2.222219843214978396e-01, LG5 = 1.818357216161805012e-01, LG6 = 1.531383769920937332e-01;
+const double LG7 = 1.479819860511658591e-01;
+const double S1 = -1.66666666666666324348e-01, S2 = 8.33333333332248946124e-03, S3 = -1.98412698298579493134e-04;
+const double S4 = 2.75573137070700676789e-06, S5 = -2.50507602534068634195e-08, S6 = 1.58969099521155010221e-10;
+const double C1 = 4.16666666666666019037e-02, C2 = -1.38888888888741095749e-03, C3 = 2.48015872894767294178e-05;
+const double C4 = -2.75573143513906633035e-07, C5 = 2.08757232129817482790e-09, C6 = -1.13596475577881948265e-11;
+const double PI_OVER_2 = 1.57079632679489661923;
+const double ROUND_MAGIC = 6755399441055744.0;  // 1.5 * 2^52, adding it rounds to an integer in the low bits
+
+// log of a normal double in (0, 1). the exponent and mantissa are split with integer operations,
+// and the mantissa is brought into [sqrt(2)/2, sqrt(2)) with a mask rather than a branch
+inline double logOpenUniform(double u) {
+  uint64_t bits = doubleBits(u);
+  double k = smallToDouble(bits >> 52) - 1023.0;
+  uint64_t mantissa = bits & 0x000FFFFFFFFFFFFFull;
+  uint64_t above = 0 - ((0x6A09E667F3BCDull - mantissa) >> 63);  // all ones when 1.mantissa > sqrt(2)
+  double m = bitsDouble((mantissa | 0x3FF0000000000000ull) - (above & 0x0010000000000000ull));
+  k += bitsDouble(above & 0x3FF0000000000000ull);
+
+  double f = m - 1.0;
+  double s = f / (2.0 + f);
+  double z = s * s;
+  double w = z * z;
+  double r = z * (LG1 + w * (LG3 + w * (LG5 + w * LG7))) + w * (LG2 + w * (LG4 + w * LG6));
+  double hfsq = 0.5 * f * f;
+  return k * LN2_HI - ((hfsq - (s * (hfsq + r) + k * LN2_LO)) - f);
+}
+
+// cosine and sine of 2 pi a for a in (0, 1). 4a is split into its nearest quadrant and a remainder
+// of at most half a quadrant, which is exact, and the quadrant swaps and negates the kernels
+inline void cosSinTurn(double a, double& cosine, double& sine) {
+  double t = 4.0 * a;
+  double rounded = t + ROUND_MAGIC;
+  uint64_t quadrant = doubleBits(rounded) & 3;
+  double x = (t - (rounded - ROUND_MAGIC)) * PI_OVER_2;
+
+  double z = x * x;
+  double sinX = x + z * x * (S1 + z * (S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)))));
+  double hz = 0.5 * z;
+  double w = 1.0 - hz;
+  double cosX = w + (((1.0 - w) - hz) + z * z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6))))));
+
+  uint64_t sinBits = doubleBits(sinX), cosBits = doubleBits(cosX);
+  uint64_t swap = (sinBits ^ cosBits) & (0 - (quadrant & 1));
+  sine = bitsDouble(sinBits ^ swap ^ (quadrant & 2) << 62);
+  cosine = bitsDouble(cosBits ^ swap ^ ((quadrant + 1) & 2) << 62);
+}
+
+// every block gives one Box-Muller pair, from a 53-bit radius and a 53-bit angle uniform. the first
+// loop is branch free and vectorizes with SSE2 already, the square root is left to a second loop
+// because its errno check is a branch
+template <int lanes>
+inline __attribute__((always_inline)) void boxMullerLanes(const uint32_t words[4][lanes], double sigma, double* output) {
+  double radiusSquared[lanes], cosine[lanes], sine[lanes];
+  for (int lane = 0; lane < lanes; lane++) {
+    radiusSquared[lane] = -2.0 * logOpenUniform(openUniform(words[0][lane], words[1][lane]));
+    cosSinTurn(openUniform(words[2][lane], words[3][lane]), cosine[lane], sine[lane]);
+  }
+  for (int lane = 0; lane < lanes; lane++) {
+    double radius = sigma * std::sqrt(radiusSquared[lane]);
+    output[2 * lane] = radius * cosine[lane];
+    output[2 * lane + 1] = radius * sine[lane];
+  }
+}
+
+} // namespace
+
+TrialRng::TrialRng(uint32_t seed, uint32_t rank) : trialIndex(0), ebn0Index(0) {
+  key[0] = seed;
+  key[1] = rank;
+  nextBlock[BIT_STREAM] = 0;
+  nextBlock[NORMAL_STREAM] = 0;
+  nextBlock[SAMPLING_STREAM] = 0;
+
+  // the kernels round identically, the choice only changes the speed
+  boxMuller = &TrialRng::boxMuller_scalar;
+#ifdef MLA_X86_RNG
+  if (__builtin_cpu_supports("avx2"))
+    boxMuller = &TrialRng::boxMuller_avx2;
+#endif
+}
+
+void TrialRng::startTrial(uint64_t trialIndex, uint32_t ebn0Index) {
+  this->trialIndex = trialIndex;
+  this->ebn0Index = ebn0Index;
+  nextBlock[BIT_STREAM] = 0;
+  nextBlock[NORMAL_STREAM] = 0;
+  nextBlock[SAMPLING_STREAM] = 0;
+}
+
+void TrialRng::block(const uint32_t counter[4], const uint32_t key[2], uint32_t output[4]) {
+  uint32_t lanes[4][1] = {{counter[0]}, {counter[1]}, {counter[2]}, {counter[3]}};
+  philoxRounds<1>(lanes, key[0], key[1]);
+  for (int word = 0; word < 4; word++)
+    output[word] = lanes[word][0];
+}
+
+// the next BATCH_BLOCKS blocks of a stream of the current trial, as output[word][block]
+void TrialRng::nextBlocks(Stream stream, uint32_t output[4][BATCH_BLOCKS]) {
+  for (int lane = 0; lane < BATCH_BLOCKS; lane++) {
+    output[0][lane] = (uint32_t)trialIndex;
+    output[1][lane] = (uint32_t)(trialIndex >> 32);
+    output[2][lane] = (ebn0Index << 8) | stream;
+    output[3][lane] = nextBlock[stream] + lane;
+  }
+  nextBlock[stream] += BATCH_BLOCKS;
+  philoxRounds<BATCH_BLOCKS>(output, key[0], key[1]);
+}
+
+// the 32-bit words of a batch, block by block, are its bits in order, two to a 64-bit word
+void TrialRng::bits(uint64_t* output, int n) {
+  const int batchWords = 2 * BATCH_BLOCKS;
+  uint32_t words[4][BATCH_BLOCKS];
+  int numWords = (n + 63) / 64;
+  for (int first = 0; first < numWords; first += batchWords) {
+    nextBlocks(BIT_STREAM, words);
+    for (int i = first; i < numWords && i < first + batchWords; i++) {
+      int low = 2 * (i - first);
+      output[i] = words[low % 4][low / 4] | (uint64_t)words[(low + 1) % 4][(low + 1) / 4] << 32;
+    }
+  }
+  if (n % 64 != 0)
+    output[numWords - 1] &= (1ull << (n % 64)) - 1;
+}
+
+void TrialRng::normals(double* output, int n, double sigma) {
+  uint32_t words[4][BATCH_BLOCKS];
+  double pairs[2 * BATCH_BLOCKS];
+  for (int first = 0; first < n; first += 2 * BATCH_BLOCKS) {
+    nextBlocks(NORMAL_STREAM, words);
+    if (n - first >= 2 * BATCH_BLOCKS) {
+      boxMuller(words, sigma, output + first);
+      continue;
+    }
+    boxMuller(words, sigma, pairs);
+    for (int i = first; i < n; i++)
+      output[i] = pairs[i - first];
+  }
+}
+
+uint32_t TrialRng::uniformIndex(uint32_t n) {
+  uint32_t counter[4] = {(uint32_t)trialIndex, (uint32_t)(trialIndex >> 32), (ebn0Index << 8) | SAMPLING_STREAM, nextBlock[SAMPLING_STREAM]++};
+  uint32_t output[4];
+  block(counter, key, output);
+  return (uint32_t)(((uint64_t)output[0] * n) >> 32);
+}
+
+void TrialRng::boxMuller_scalar(const uint32_t words[4][BATCH_BLOCKS], double sigma, double* output) {
+  boxMullerLanes<BATCH_BLOCKS>(words, sigma, output);
+}
+
+// without FMA, so products and sums round as in the scalar kernel
+#ifdef MLA_X86_RNG
+__attribute__((target("avx2")))
+#endif
+void TrialRng::boxMuller_avx2(const uint32_t words[4][BATCH_BLOCKS], double sigma, double* output) {
+  boxMullerLanes<BATCH_BLOCKS>(words, sigma, output);
+}
@@ -0,0 +1,107 @@
+#include "../include/workStealingPool.h"
+
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(int numThreads)
+  : queues(std::max(1, numThreads)), task(nullptr), round(0), busyWorkers(0), stopping(false), taskFailed(false) {
+  for (int worker = 1; worker < size(); worker++)
+    threads.push_back(std::thread(&WorkStealingPool::workerLoop, this, worker));
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  roundStarted.notify_all();
+  for (size_t thread = 0; thread < threads.size(); thread++)
+    threads[thread].join();
+}
+
+int WorkStealingPool::size() const { return (int)queues.size(); }
+
+void WorkStealingPool::run(int numTasks, const std::function<void(int, int)>& task) {
+  // every worker starts with a contiguous block, neighbouring tasks stay together until stolen
+  int workers = size();
+  for (int worker = 0; worker < workers; worker++) {
+    std::lock_guard<std::mutex> lock(queues[worker].mutex);
+    int firstTask = (long long)numTasks * worker / workers;
+    int lastTask = (long long)numTasks * (worker + 1) / workers;
+    for (int index = firstTask; index < lastTask; index++)
+      queues[worker].tasks.push_back(index);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->task = &task;
+    taskException = nullptr;
+    taskFailed.store(false, std::memory_order_relaxed);
+    busyWorkers = workers - 1;
+    round++;
+  }
+  roundStarted.notify_all();
+  runTasks(0);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  roundFinished.wait(lock, [this] { return busyWorkers == 0; });
+  this->task = nullptr;
+  if (taskException)
+    std::rethrow_exception(taskException);
+}
+
+void WorkStealingPool::workerLoop(int worker) {
+  int seenRound = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      roundStarted.wait(lock, [&] { return stopping || round != seenRound; });
+      if (stopping)
+        return;
+      seenRound = round;
+    }
+    runTasks(worker);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      busyWorkers--;
+    }
+    roundFinished.notify_one();
+  }
+}
+
+// runs tasks until every queue is empty. a task only takes the lock of the queue it comes from,
+// the round mutex is left to the start, the end and a failing task. after a task throws, the
+// worker drains its tasks without running them so the round still ends
+void WorkStealingPool::runTasks(int worker) {
+  int index;
+  while (nextTask(worker, index)) {
+    if (taskFailed.load(std::memory_order_relaxed))
+      continue;
+    try {
+      (*task)(worker, index);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!taskException)
+        taskException = std::current_exception();
+      taskFailed.store(true, std::memory_order_relaxed);
+    }
+  }
+}
+
+// the front of the worker's own queue, otherwise the back of the first other queue with work
+bool WorkStealingPool::nextTask(int worker, int& index) {
+  for (int offset = 0; offset < size(); offset++) {
+    WorkerQueue& queue = queues[(worker + offset) % size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+      continue;
+    if (offset == 0) {
+      index = queue.tasks.front();
+      queue.tasks.pop_front();
+    } else {
+      index = queue.tasks.back();
+      queue.tasks.pop_back();
+    }
+    return true;
+  }
+  return false;
+}
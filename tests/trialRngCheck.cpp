@@ -0,0 +1,131 @@
+// known answers of the Philox block and of the streams TrialRng draws from it
+//
+//   trialRngCheck   exits nonzero on the first mismatch
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "../include/trialRng.h"
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+  if (!ok && failures++ < 10)
+    std::cerr << what << " differs" << std::endl;
+}
+
+// the Philox4x32-10 vectors of the Random123 distribution
+static void checkBlocks() {
+  struct Vector {
+    uint32_t counter[4];
+    uint32_t key[2];
+    uint32_t output[4];
+  };
+  const Vector vectors[] = {
+    {{0x00000000, 0x00000000, 0x00000000, 0x00000000}, {0x00000000, 0x00000000}, {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}},
+    {{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}, {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}},
+    {{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}, {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}},
+  };
+  for (const Vector& vector : vectors) {
+    uint32_t output[4];
+    TrialRng::block(vector.counter, vector.key, output);
+    for (int word = 0; word < 4; word++)
+      expect(output[word] == vector.output[word], "Philox block");
+  }
+}
+
+// the block of one stream of a trial, laid out as TrialRng counts them
+static void streamBlock(uint32_t seed, uint32_t rank, uint64_t trial, uint32_t ebn0, uint32_t stream, uint32_t block, uint32_t output[4]) {
+  uint32_t counter[4] = {(uint32_t)trial, (uint32_t)(trial >> 32), (ebn0 << 8) | stream, block};
+  uint32_t key[2] = {seed, rank};
+  TrialRng::block(counter, key, output);
+}
+
+static double openUniform(uint32_t high, uint32_t low) {
+  uint64_t bits53 = ((uint64_t)high << 21) ^ (low >> 11);
+  return ((double)bits53 + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// bits are the words of the bit stream in block order, normals are Box-Muller on the normal stream,
+// within a few ulp of the math library
+static void checkStreams() {
+  const uint32_t seed = 42, rank = 3, ebn0 = 5;
+  const uint64_t trial = 0x100000007ull;
+  TrialRng rng(seed, rank);
+
+  const int numBits = 300;
+  std::vector<uint64_t> bits((numBits + 63) / 64);
+  rng.startTrial(trial, ebn0);
+  rng.bits(bits.data(), numBits);
+  for (int word = 0; word < (int)bits.size(); word++) {
+    uint32_t words[4];
+    streamBlock(seed, rank, trial, ebn0, 0, word / 2, words);
+    uint64_t expected = words[2 * (word % 2)] | (uint64_t)words[2 * (word % 2) + 1] << 32;
+    if (word == numBits / 64)
+      expected &= (1ull << (numBits % 64)) - 1;
+    expect(bits[word] == expected, "bit stream");
+  }
+
+  const int numNormals = 1000;
+  const double sigma = 0.75;
+  std::vector<double> normals(numNormals);
+  rng.startTrial(trial, ebn0);
+  rng.normals(normals.data(), numNormals, sigma);
+  for (int pair = 0; pair < numNormals / 2; pair++) {
+    uint32_t words[4];
+    streamBlock(seed, rank, trial, ebn0, 1, pair, words);
+    double radius = sigma * std::sqrt(-2.0 * std::log(openUniform(words[0], words[1])));
+    double angle = 6.283185307179586 * openUniform(words[2], words[3]);
+    expect(std::fabs(normals[2 * pair] - radius * std::cos(angle)) <= 1e-14 * (1.0 + radius), "normal stream cosine");
+    expect(std::fabs(normals[2 * pair + 1] - radius * std::sin(angle)) <= 1e-14 * (1.0 + radius), "normal stream sine");
+  }
+
+  // a draw that ends inside a batch gives the start of the longer draw
+  std::vector<double> partial(21);
+  rng.startTrial(trial, ebn0);
+  rng.normals(partial.data(), (int)partial.size(), sigma);
+  for (size_t i = 0; i < partial.size(); i++)
+    expect(partial[i] == normals[i], "partial normal batch");
+
+  // indices take the first word of one sampling block each, and leave the other streams alone
+  const uint32_t range = 77;
+  rng.startTrial(trial, ebn0);
+  for (uint32_t draw = 0; draw < 4; draw++) {
+    uint32_t words[4];
+    streamBlock(seed, rank, trial, ebn0, 2, draw, words);
+    expect(rng.uniformIndex(range) == (uint32_t)(((uint64_t)words[0] * range) >> 32), "sampling stream");
+  }
+  rng.normals(partial.data(), (int)partial.size(), sigma);
+  for (size_t i = 0; i < partial.size(); i++)
+    expect(partial[i] == normals[i], "normals after sampling draws");
+}
+
+// the normals bit for bit, as the bit patterns of the doubles, which every kernel has to reproduce
+static void checkNormalValues() {
+  const uint64_t expected[] = {0xbfd6a755122c628full, 0xbff0be935a3e571dull, 0xbff6a74c227757d7ull, 0x3fd02e4124393fe0ull,
+                               0x3ff36459b67c004eull, 0x3fba3e9d243c05deull, 0xbff035d95cd4e056ull, 0xbf545f3fe05965b4ull};
+  double normals[8];
+  TrialRng rng(42, 0);
+  rng.startTrial(7, 3);
+  rng.normals(normals, 8, 1.0);
+  for (int i = 0; i < 8; i++) {
+    uint64_t bits;
+    std::memcpy(&bits, &normals[i], sizeof(bits));
+    expect(bits == expected[i], "normal known answer");
+  }
+}
+
+int main() {
+  checkBlocks();
+  checkStreams();
+  checkNormalValues();
+  if (failures > 0) {
+    std::cerr << failures << " mismatches" << std::endl;
+    return 1;
+  }
+  std::cout << "trialRng: Philox vectors, bit, normal and sampling streams agree" << std::endl;
+  return 0;
+}
@@ -0,0 +1,154 @@
+// replays the detour heap traffic of recorded decodes through the original binary heap and MinHeap
+//
+//   heapBenchmark [EbN0] [frames]   decodes frames with the simulator's code at EbN0, 2.0 and 2000 by
+//                                   default, records the heap operations of their list searches and
+//                                   times both heaps on the same trace
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "../include/feedForwardTrellis.h"
+#include "../include/lowRateListDecoder.h"
+#include "../include/minHeap.h"
+#include "../include/mla_consts.h"
+#include "../include/mla_namespace.h"
+#include "../include/trialRng.h"
+
+// the heap the decoder had before MinHeap: binary, recursive, swapping 32-byte detours
+struct BaselineDetour {
+  double pathMetric;
+  double forwardPathMetric;
+  int detourStage;
+  int startingState;
+  int originalPathIndex;
+  bool operator<(const BaselineDetour& obj) { return pathMetric < obj.pathMetric; }
+  bool operator>(const BaselineDetour& obj) { return pathMetric > obj.pathMetric; }
+};
+
+class BaselineHeap {
+public:
+  void insert(BaselineDetour detour) {
+    detourList.push_back(detour);
+    int index = detourList.size() - 1;
+    while (index > 0 && detourList[(index - 1) / 2] > detourList[index]) {
+      std::swap(detourList[(index - 1) / 2], detourList[index]);
+      index = (index - 1) / 2;
+    }
+  }
+  BaselineDetour pop() {
+    BaselineDetour detour = detourList[0];
+    detourList[0] = detourList[detourList.size() - 1];
+    detourList.pop_back();
+    reHeap(0);
+    return detour;
+  }
+  void clear() { detourList.clear(); }
+
+private:
+  std::vector<BaselineDetour> detourList;
+  void reHeap(int index) {
+    int leftIndex = 2 * index + 1;
+    int rightIndex = 2 * index + 2;
+    int minDetourIndex = index;
+    if (leftIndex < (int)detourList.size() && detourList[leftIndex] < detourList[minDetourIndex])
+      minDetourIndex = leftIndex;
+    if (rightIndex < (int)detourList.size() && detourList[rightIndex] < detourList[minDetourIndex])
+      minDetourIndex = rightIndex;
+    if (minDetourIndex != index) {
+      std::swap(detourList[index], detourList[minDetourIndex]);
+      reHeap(minDetourIndex);
+    }
+  }
+};
+
+// decodes frames like the simulator does and records their heap operations
+void recordTrace(double EbN0, int frames, HeapTrace& trace) {
+  std::vector<int> numerators = {POLY1, POLY2};
+  FeedForwardTrellis trellis(K, N, V, numerators);
+  LowRateListDecoder decoder(trellis, MAX_LISTSIZE, M + 1, CRC, STOPPING_RULE);
+  PuncturingPattern puncturing(PUNCTURING_INDICES, N / K * (NUM_INFO_BITS + M));
+  double snr = EbN0 + 10 * std::log10((double)N / K * NUM_INFO_BITS / NUM_CODED_SYMBOLS);
+
+  TrialRng rng(BASE_SEED, 0);
+  BitVector message, codeword;
+  std::vector<double> received;
+  MessageInformation result;
+  decoder.recordHeapTrace(&trace);
+  for (int frame = 0; frame < frames; frame++) {
+    rng.startTrial(frame, 0);
+    message.reset(NUM_INFO_BITS);
+    rng.bits(message.words(), NUM_INFO_BITS);
+    crc::crc_calculation(message, M + 1, CRC);
+    trellis.encode(message, codeword);
+    awgn::addNoise(codeword, snr, rng, received);
+    for (size_t i = 0; i < PUNCTURING_INDICES.size(); i++)
+      received[PUNCTURING_INDICES[i]] = 0;
+    decoder.decode(received, puncturing, result);
+  }
+  decoder.recordHeapTrace(nullptr);
+}
+
+double poppedMetric(const BaselineDetour& detour) { return detour.pathMetric; }
+double poppedMetric(const DetourObject& detour) { return detour.pathMetric(); }
+
+// best of five replays, in nanoseconds per operation. the popped metrics are summed, which also
+// checks that both heaps pop the same metrics in the same order
+template <typename Heap, typename Convert>
+double replay(const HeapTrace& trace, Convert convert, double& checksum) {
+  double best = 1e300;
+  for (int repeat = 0; repeat < 5; repeat++) {
+    Heap heap;
+    checksum = 0;
+    size_t next = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < trace.ops.size(); i++) {
+      if (trace.ops[i] == HeapTrace::INSERT)
+        heap.insert(convert(trace.inserted[next++]));
+      else if (trace.ops[i] == HeapTrace::POP)
+        checksum += poppedMetric(heap.pop());
+      else
+        heap.clear();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count() / trace.ops.size());
+  }
+  return best;
+}
+
+int main(int argc, char* argv[]) {
+  double EbN0 = argc > 1 ? std::atof(argv[1]) : 2.0;
+  int frames = argc > 2 ? std::atoi(argv[2]) : 2000;
+
+  HeapTrace trace;
+  recordTrace(EbN0, frames, trace);
+  if (trace.ops.empty()) {
+    std::cerr << "no frame reached the heap" << std::endl;
+    return 1;
+  }
+
+  // the largest the heap got between clears
+  long long size = 0, peak = 0;
+  for (size_t i = 0; i < trace.ops.size(); i++) {
+    size = trace.ops[i] == HeapTrace::INSERT ? size + 1 : trace.ops[i] == HeapTrace::POP ? size - 1 : 0;
+    peak = std::max(peak, size);
+  }
+  std::cout << frames << " frames at Eb/N0 = " << EbN0 << ": " << trace.ops.size() << " heap operations, "
+            << trace.inserted.size() << " inserts, peak size " << peak << std::endl;
+
+  double baselineChecksum, minHeapChecksum;
+  double baselineTime = replay<BaselineHeap>(trace, [](const DetourObject& detour) {
+    BaselineDetour converted = {detour.pathMetric(), detour.forwardPathMetric, detour.detourStage, detour.startingState, detour.originalPathIndex};
+    return converted;
+  }, baselineChecksum);
+  double minHeapTime = replay<MinHeap>(trace, [](const DetourObject& detour) { return detour; }, minHeapChecksum);
+
+  std::cout << "baseline binary heap: " << baselineTime << " ns/op, " << peak * sizeof(BaselineDetour) << " bytes at peak" << std::endl;
+  std::cout << "MinHeap:              " << minHeapTime << " ns/op, " << peak * sizeof(DetourObject) << " bytes at peak" << std::endl;
+  if (baselineChecksum != minHeapChecksum)
+    std::cout << "warning: the heaps popped different detours" << std::endl;
+  return 0;
+}
@@ -0,0 +1,70 @@
+// merges the binary record files of the ranks and converts record files to csv
+//
+//   mergeRecords merge <output.bin> <input.bin>...   concatenates the inputs, which must share an Eb/N0
+//   mergeRecords csv <input.bin>...                  writes the records of the inputs as csv to stdout
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../include/trialRecords.h"
+
+int usage() {
+  std::cerr << "usage: mergeRecords merge <output.bin> <input.bin>..." << std::endl;
+  std::cerr << "       mergeRecords csv <input.bin>..." << std::endl;
+  return 1;
+}
+
+void mergeFiles(const std::string& outputName, const std::vector<std::string>& inputNames) {
+  std::vector<TrialRecord> merged;
+  double EbN0 = 0.0;
+  for (size_t i = 0; i < inputNames.size(); i++) {
+    RecordFileHeader header;
+    std::vector<TrialRecord> records;
+    records::readFile(inputNames[i], header, records);
+    if (i == 0)
+      EbN0 = header.EbN0;
+    else if (header.EbN0 != EbN0)
+      throw std::runtime_error(inputNames[i] + " is from another Eb/N0 point");
+    merged.insert(merged.end(), records.begin(), records.end());
+  }
+
+  std::ofstream output(outputName.c_str(), std::ios::binary);
+  if (!output)
+    throw std::runtime_error("cannot open " + outputName);
+  records::writeHeader(output, records::makeHeader(EbN0, -1));
+  records::writeRecords(output, merged);
+  std::cerr << merged.size() << " records merged into " << outputName << std::endl;
+}
+
+void convertFiles(const std::vector<std::string>& inputNames) {
+  std::vector<TrialRecord> all;
+  for (size_t i = 0; i < inputNames.size(); i++) {
+    RecordFileHeader header;
+    std::vector<TrialRecord> records;
+    records::readFile(inputNames[i], header, records);
+    all.insert(all.end(), records.begin(), records.end());
+  }
+  records::writeCsv(std::cout, all);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 3)
+    return usage();
+  std::string command = argv[1];
+  try {
+    if (command == "merge" && argc >= 4) {
+      mergeFiles(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    } else if (command == "csv") {
+      convertFiles(std::vector<std::string>(argv + 2, argv + argc));
+    } else {
+      return usage();
+    }
+  } catch (const std::exception& error) {
+    std::cerr << "[ERROR] " << error.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}